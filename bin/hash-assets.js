@@ -0,0 +1,76 @@
+#!/usr/bin/env node
+/**
+ * Copies the build artifacts the browser loads to content-hashed names under
+ * build/assets so they can be cached forever, and updates the references to
+ * them. The unhashed files are left in place for the headless runner.
+ *
+ * Usage: hash-assets.js <dist directory>
+ */
+const { createHash } = require("crypto");
+const fs = require("fs");
+const path = require("path");
+
+const dist = process.argv[2];
+if (!dist) {
+  console.error("Usage: hash-assets.js <dist directory>");
+  process.exit(1);
+}
+const build = path.join(dist, "build");
+const assets = path.join(build, "assets");
+
+// Ordered so that each file's references are updated before it's hashed.
+const artifacts = [
+  "firmware.wasm",
+  "firmware.js",
+  "firmware-blocking.wasm",
+  "firmware-blocking.js",
+  "worker.js",
+  "audio-worklet.js",
+  "simulator.js",
+];
+const pages = ["simulator.html"];
+
+const hashed = new Map();
+
+const replaceReferences = (content, fromAssets) => {
+  for (const [name, hashedName] of hashed) {
+    // References relative to the page, then relative to the asset itself.
+    content = content
+      .split(`"./build/${name}"`)
+      .join(`"./build/assets/${hashedName}"`)
+      .split(`"build/${name}"`)
+      .join(`"build/assets/${hashedName}"`);
+    if (fromAssets) {
+      content = content.split(`"${name}"`).join(`"${hashedName}"`);
+    }
+  }
+  return content;
+};
+
+fs.rmSync(assets, { recursive: true, force: true });
+fs.mkdirSync(assets);
+for (const name of artifacts) {
+  const optional = name.startsWith("firmware-blocking");
+  if (optional && !fs.existsSync(path.join(build, name))) {
+    // Only built by make blocking.
+    continue;
+  }
+  let content = fs.readFileSync(path.join(build, name));
+  if (!name.endsWith(".wasm")) {
+    content = Buffer.from(replaceReferences(content.toString(), true));
+  }
+  const hash = createHash("sha256").update(content).digest("hex").slice(0, 10);
+  const { name: base, ext } = path.parse(name);
+  const hashedName = `${base}.${hash}${ext}`;
+  fs.writeFileSync(path.join(assets, hashedName), content);
+  hashed.set(name, hashedName);
+}
+for (const name of pages) {
+  const file = path.join(dist, name);
+  const content = fs.readFileSync(file).toString();
+  const updated = replaceReferences(content, false);
+  if (updated === content) {
+    throw new Error(`No references to update in ${name}`);
+  }
+  fs.writeFileSync(file, updated);
+}
@@ -32,8 +32,9 @@ module.exports = {
     "**/*": {
       CacheControl: "public, max-age=0, must-revalidate",
     },
-    // We need hashes in the filenames to enable these
-    // "**/**/!(sw).js": { CacheControl: "public, max-age=31536000, immutable" },
-    // "**/**.wasm": { CacheControl: "public, max-age=31536000, immutable" },
+    // Content-hashed, see bin/hash-assets.js.
+    "**/build/assets/**": {
+      CacheControl: "public, max-age=31536000, immutable",
+    },
   },
 };
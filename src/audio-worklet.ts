@@ -0,0 +1,51 @@
+import { AudioRing } from "./board/audio/ring";
+
+// Plays the audio the main thread writes to the rings. See
+// board/audio/index.ts for the other side.
+//
+// Posts the index of a ring to the main thread when it needs more audio.
+
+// The AudioWorkletGlobalScope globals we use, as tsconfig only includes the
+// DOM types.
+declare const sampleRate: number;
+declare class AudioWorkletProcessor {
+  readonly port: MessagePort;
+}
+declare function registerProcessor(
+  name: string,
+  processorCtor: new (options: any) => AudioWorkletProcessor
+): void;
+
+interface RingProcessorOptions {
+  processorOptions: {
+    buffers: SharedArrayBuffer[];
+  };
+}
+
+class RingProcessor extends AudioWorkletProcessor {
+  private rings: AudioRing[];
+
+  constructor(options: RingProcessorOptions) {
+    super();
+    this.rings = options.processorOptions.buffers.map(
+      (buffer) => new AudioRing(buffer)
+    );
+  }
+
+  process(inputs: Float32Array[][], outputs: Float32Array[][]): boolean {
+    const output = outputs[0];
+    const mix = output[0];
+    this.rings.forEach((ring, index) => {
+      ring.mixInto(mix, sampleRate);
+      if (ring.shouldRequest()) {
+        this.port.postMessage(index);
+      }
+    });
+    for (let channel = 1; channel < output.length; ++channel) {
+      output[channel].set(mix);
+    }
+    return true;
+  }
+}
+
+registerProcessor("ring-processor", RingProcessor);
@@ -0,0 +1,355 @@
+import { createHash } from "crypto";
+import { readdir, readFile, stat, writeFile } from "fs/promises";
+import { basename, dirname, join } from "path";
+import { FileSystem } from "./board/fs";
+import {
+  Firmware,
+  HeadlessNotifications,
+  HeadlessResult,
+  HeadlessStopKind,
+} from "./board/headless";
+import { RadioNetwork } from "./board/radio-network";
+import { SharedBoardState } from "./board/shared-state";
+import { WorkerBoard } from "./board/worker-board";
+import { loadFirmware } from "./node-firmware";
+
+const usage = `Usage: node benchmark.js [options] <dir or file.py> ...
+
+Runs MicroPython benchmarks on headless boards and prints a JSON report.
+
+Benchmarks report results by printing lines of the form:
+  BENCH <name> <ops> <elapsed ms> <slowest op ms>
+bench.py in a benchmark directory is available to every benchmark as a
+module with helpers for this. A first line of "# boards: <n>" runs the
+benchmark on that many boards, which can hear each other's radio.
+
+Options:
+  --timeout <ms>   Interrupt each benchmark after this long (default 60000).
+  --runs <n>       Run each benchmark this many times (default 1).
+  --label <text>   Included in the report, e.g. the release being measured.
+  --output <file>  Write the report to a file rather than stdout.
+  --blocking       Use the firmware without asyncify, from make blocking.
+                   Only for single board benchmarks.
+`;
+
+// Bump when the report format changes incompatibly.
+const reportVersion = 1;
+const helperName = "bench.py";
+const resultPrefix = "BENCH ";
+
+interface Options {
+  timeoutMs: number;
+  runs: number;
+  label?: string;
+  output?: string;
+  blocking: boolean;
+  paths: string[];
+}
+
+interface Benchmark {
+  name: string;
+  main: Uint8Array;
+  helper: Uint8Array | undefined;
+  boards: number;
+}
+
+interface BenchmarkResult {
+  name: string;
+  board: number;
+  ops: number;
+  elapsedMs: number;
+  opsPerSecond: number | null;
+  meanLatencyMs: number;
+  maxLatencyMs: number;
+}
+
+interface BenchmarkRun {
+  benchmark: string;
+  run: number;
+  boards: number;
+  kind: HeadlessStopKind;
+  error?: string;
+  durationMs: number;
+  results: BenchmarkResult[];
+}
+
+const parseArgs = (args: string[]): Options => {
+  const options: Options = {
+    timeoutMs: 60_000,
+    runs: 1,
+    blocking: false,
+    paths: [],
+  };
+  for (let i = 0; i < args.length; ++i) {
+    const arg = args[i];
+    const value = () => {
+      if (i + 1 >= args.length) {
+        throw new Error(`Missing value for ${arg}`);
+      }
+      return args[++i];
+    };
+    switch (arg) {
+      case "--timeout": {
+        options.timeoutMs = parseInt(value(), 10);
+        if (!(options.timeoutMs > 0)) {
+          throw new Error("Invalid --timeout");
+        }
+        break;
+      }
+      case "--runs": {
+        options.runs = parseInt(value(), 10);
+        if (!(options.runs > 0)) {
+          throw new Error("Invalid --runs");
+        }
+        break;
+      }
+      case "--label": {
+        options.label = value();
+        break;
+      }
+      case "--output": {
+        options.output = value();
+        break;
+      }
+      case "--blocking": {
+        options.blocking = true;
+        break;
+      }
+      default: {
+        if (arg.startsWith("--")) {
+          throw new Error(`Unknown option ${arg}`);
+        }
+        options.paths.push(arg);
+      }
+    }
+  }
+  if (options.paths.length === 0) {
+    throw new Error("No benchmarks specified");
+  }
+  return options;
+};
+
+const readBenchmarks = async (paths: string[]): Promise<Benchmark[]> => {
+  const benchmarks: Benchmark[] = [];
+  for (const path of paths) {
+    const isDirectory = (await stat(path)).isDirectory();
+    const files = isDirectory
+      ? (await readdir(path))
+          .filter((name) => name.endsWith(".py"))
+          .sort()
+          .map((name) => join(path, name))
+      : [path];
+    const dir = isDirectory ? path : dirname(path);
+    const helper = await readFile(join(dir, helperName)).catch(
+      () => undefined
+    );
+    for (const file of files) {
+      if (basename(file) === helperName) {
+        continue;
+      }
+      const main = await readFile(file);
+      const boards = /^# boards: (\d+)/.exec(main.toString());
+      benchmarks.push({
+        name: basename(file, ".py"),
+        main,
+        helper,
+        boards: boards ? parseInt(boards[1], 10) : 1,
+      });
+    }
+  }
+  return benchmarks;
+};
+
+const parseResults = (board: number, serial: string): BenchmarkResult[] =>
+  serial
+    .split(/\r?\n/)
+    .filter((line) => line.startsWith(resultPrefix))
+    .map((line) => {
+      const [name, ops, elapsedMs, maxLatencyMs] = line
+        .slice(resultPrefix.length)
+        .trim()
+        .split(/\s+/);
+      const opCount = Number(ops);
+      const elapsed = Number(elapsedMs);
+      return {
+        name,
+        board,
+        ops: opCount,
+        elapsedMs: elapsed,
+        // Too quick to measure with the millisecond clock.
+        opsPerSecond: elapsed > 0 ? (opCount * 1000) / elapsed : null,
+        meanLatencyMs: opCount > 0 ? elapsed / opCount : 0,
+        maxLatencyMs: Number(maxLatencyMs ?? 0),
+      };
+    });
+
+const createFileSystem = (benchmark: Benchmark): FileSystem => {
+  const fs = new FileSystem();
+  fs.write(fs.create("main.py"), benchmark.main, true);
+  if (benchmark.helper) {
+    fs.write(fs.create(helperName), benchmark.helper, true);
+  }
+  return fs;
+};
+
+const createNotifications = (
+  onSerialOutput: (data: string) => void
+): HeadlessNotifications => ({
+  onStateChange: () => {},
+  onSerialOutput,
+  onRadioOutput: () => {},
+  onLogOutput: () => {},
+  onLogDelete: () => {},
+});
+
+/**
+ * Runs the blocking firmware on this thread. It doesn't return to the event
+ * loop until it stops so the timeout is checked each time it waits.
+ */
+class BlockingBoard extends WorkerBoard {
+  private deadline = Number.POSITIVE_INFINITY;
+  private timedOut = false;
+
+  constructor(
+    firmware: Firmware,
+    fs: FileSystem,
+    notifications: HeadlessNotifications,
+    private sharedState: SharedBoardState
+  ) {
+    super(firmware, fs, notifications, sharedState);
+  }
+
+  async run(timeoutMs: number): Promise<HeadlessResult> {
+    const start = Date.now();
+    this.deadline = start + timeoutMs;
+    this.timedOut = false;
+    // As HeadlessBoard.run, stop after main.py rather than entering the REPL.
+    this.sharedState.requestStop(1);
+    const result = await this.start(1);
+    return {
+      ...result,
+      kind: this.timedOut ? "timeout" : result.kind,
+      durationMs: Date.now() - start,
+    };
+  }
+
+  wait(ms: number) {
+    if (!this.timedOut && Date.now() > this.deadline) {
+      this.timedOut = true;
+      // Ctrl-C. A program that ignores it isn't abandoned as we can't get
+      // control back.
+      this.sharedState.writeSerialInput(3);
+    }
+    super.wait(ms);
+  }
+}
+
+const runBenchmark = async (
+  benchmark: Benchmark,
+  run: number,
+  timeoutMs: number,
+  firmware: Firmware
+): Promise<BenchmarkRun> => {
+  if (firmware.blocking && benchmark.boards !== 1) {
+    // Each board would block the others.
+    return {
+      benchmark: benchmark.name,
+      run,
+      boards: benchmark.boards,
+      kind: "error",
+      error: "Multiple boards aren't supported with --blocking",
+      durationMs: 0,
+      results: [],
+    };
+  }
+  const serial: string[] = [];
+  let results: HeadlessResult[];
+  if (firmware.blocking) {
+    serial.push("");
+    const board = new BlockingBoard(
+      firmware,
+      createFileSystem(benchmark),
+      createNotifications((data) => {
+        serial[0] += data;
+      }),
+      new SharedBoardState()
+    );
+    results = [await board.run(timeoutMs)];
+  } else {
+    const network = new RadioNetwork();
+    for (let i = 0; i < benchmark.boards; ++i) {
+      serial.push("");
+      network.addBoard(
+        firmware,
+        createFileSystem(benchmark),
+        createNotifications((data) => {
+          serial[i] += data;
+        })
+      );
+    }
+    results = await network.run(timeoutMs);
+  }
+  // The first board that didn't finish normally is reported.
+  const stopped = results.find((result) => result.kind !== "default");
+  return {
+    benchmark: benchmark.name,
+    run,
+    boards: benchmark.boards,
+    kind: stopped?.kind ?? "default",
+    error: stopped?.error?.toString(),
+    durationMs: Math.round(Math.max(...results.map((r) => r.durationMs))),
+    results: serial.flatMap((output, i) => parseResults(i, output)),
+  };
+};
+
+const main = async (args: string[]): Promise<number> => {
+  let options: Options;
+  try {
+    options = parseArgs(args);
+  } catch (e: any) {
+    process.stderr.write(`${e.message}\n\n${usage}`);
+    return 1;
+  }
+
+  const benchmarks = await readBenchmarks(options.paths);
+  const firmware = await loadFirmware(__dirname, options.blocking);
+  const wasm = await readFile(
+    join(
+      __dirname,
+      options.blocking ? "firmware-blocking.wasm" : "firmware.wasm"
+    )
+  );
+  const runs: BenchmarkRun[] = [];
+  for (const benchmark of benchmarks) {
+    for (let run = 0; run < options.runs; ++run) {
+      process.stderr.write(`${benchmark.name} (run ${run + 1})\n`);
+      runs.push(
+        await runBenchmark(benchmark, run, options.timeoutMs, firmware)
+      );
+    }
+  }
+
+  const report = {
+    version: reportVersion,
+    label: options.label,
+    date: new Date().toISOString(),
+    node: process.version,
+    firmware: {
+      blocking: options.blocking,
+      bytes: wasm.length,
+      sha256: createHash("sha256").update(wasm).digest("hex"),
+    },
+    runs,
+  };
+  const json = JSON.stringify(report, null, 2) + "\n";
+  if (options.output) {
+    await writeFile(options.output, json);
+  } else {
+    process.stdout.write(json);
+  }
+  return runs.every((run) => run.kind === "default") ? 0 : 1;
+};
+
+main(process.argv.slice(2)).then((code) => {
+  process.exitCode = code;
+});
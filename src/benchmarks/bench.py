@@ -0,0 +1,27 @@
+# Timing helpers for the benchmarks. Each result is printed as a line that
+# the benchmark runner parses:
+#   BENCH <name> <ops> <elapsed ms> <slowest op ms>
+import utime
+
+
+def report(name, ops, elapsed_ms, slowest_ms=0):
+    print("BENCH", name, ops, elapsed_ms, slowest_ms)
+
+
+def measure(name, ops, fn):
+    # fn does all the ops in one call. For fast ops where timing each one
+    # would swamp them.
+    start = utime.ticks_ms()
+    fn()
+    report(name, ops, utime.ticks_diff(utime.ticks_ms(), start))
+
+
+def each(name, ops, fn):
+    # Calls fn(i) for each op, also tracking the slowest.
+    slowest = 0
+    start = utime.ticks_ms()
+    for i in range(ops):
+        op_start = utime.ticks_ms()
+        fn(i)
+        slowest = max(slowest, utime.ticks_diff(utime.ticks_ms(), op_start))
+    report(name, ops, utime.ticks_diff(utime.ticks_ms(), start), slowest)
@@ -0,0 +1,47 @@
+# Interpreter throughput: arithmetic, function calls and a small sieve.
+from bench import measure
+
+N = 20000
+
+
+def int_loop():
+    total = 0
+    for i in range(N):
+        total += i * 3 % 7
+    return total
+
+
+def float_loop():
+    x = 0.0
+    for i in range(N):
+        x = x * 0.5 + i / 3
+    return x
+
+
+def add(a, b):
+    return a + b
+
+
+def calls():
+    total = 0
+    for i in range(N):
+        total = add(total, i)
+    return total
+
+
+def sieve():
+    size = 2000
+    flags = [True] * size
+    count = 0
+    for i in range(2, size):
+        if flags[i]:
+            count += 1
+            for j in range(i * i, size, i):
+                flags[j] = False
+    return count
+
+
+measure("int_loop", N, int_loop)
+measure("float_loop", N, float_loop)
+measure("function_calls", N, calls)
+measure("sieve_2000", 1, sieve)
@@ -0,0 +1,9 @@
+# Data logging bursts.
+import log
+from bench import each
+
+log.delete()
+log.set_labels("a", "b", "c", timestamp=None)
+each("log_add", 500, lambda i: log.add(a=i, b=i * 2, c=i % 7))
+each("log_add_dict", 200, lambda i: log.add({"a": i, "b": "text", "c": 1.5}))
+log.delete()
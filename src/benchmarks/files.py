@@ -0,0 +1,38 @@
+# File system throughput: repeated writes to one file, then reading it back.
+import os
+from bench import each, measure
+
+CHUNK = "x" * 63 + "\n"
+CHUNKS = 200
+
+
+def write_file():
+    with open("bench.txt", "w") as f:
+        for i in range(CHUNKS):
+            f.write(CHUNK)
+
+
+def read_file():
+    with open("bench.txt") as f:
+        while f.read(256):
+            pass
+
+
+def read_lines():
+    with open("bench.txt") as f:
+        for line in f:
+            pass
+
+
+def create_remove(i):
+    with open("small.txt", "w") as f:
+        f.write(str(i))
+    os.remove("small.txt")
+
+
+measure("file_append_bytes", CHUNKS * len(CHUNK), write_file)
+measure("file_read_bytes", CHUNKS * len(CHUNK), read_file)
+measure("file_readline", CHUNKS, read_lines)
+each("file_create_remove", 20, create_remove)
+
+os.remove("bench.txt")
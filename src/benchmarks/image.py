@@ -0,0 +1,24 @@
+# Image operations and showing images on the display.
+from bitsflow import *
+from bench import each, measure
+
+N = 500
+
+
+def image_ops():
+    for i in range(N):
+        img = Image.HEART.shift_left(i % 5).invert()
+        img = img + Image.SMILE
+        img.set_pixel(i % 5, 2, 9)
+
+
+def image_create():
+    for i in range(N):
+        Image("90009:09090:00900:09090:90009")
+
+
+measure("image_ops", N, image_ops)
+measure("image_create", N, image_create)
+each("display_show", N, lambda i: display.show(Image.ALL_CLOCKS[i % 12]))
+each("display_set_pixel", N, lambda i: display.set_pixel(i % 5, i // 5 % 5, i % 10))
+display.clear()
@@ -0,0 +1,26 @@
+# boards: 2
+# Radio throughput between two boards. Each board sends packets as fast as
+# it can while receiving the other's.
+import radio
+import utime
+from bench import report
+
+N = 500
+
+radio.config(group=7, queue=10)
+radio.on()
+received = 0
+start = utime.ticks_ms()
+for i in range(N):
+    radio.send("packet %d" % i)
+    while radio.receive():
+        received += 1
+sent_ms = utime.ticks_diff(utime.ticks_ms(), start)
+report("radio_send", N, sent_ms)
+# Collect any stragglers.
+deadline = utime.ticks_add(utime.ticks_ms(), 200)
+while utime.ticks_diff(deadline, utime.ticks_ms()) > 0:
+    if radio.receive():
+        received += 1
+report("radio_receive", received, sent_ms)
+radio.off()
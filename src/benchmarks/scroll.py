@@ -0,0 +1,20 @@
+# Scrolling text. With no delay this measures the cost of rendering each
+# frame rather than the scroll speed.
+from bitsflow import *
+from bench import each, measure
+
+TEXT = "Hello, World! 0123456789"
+# Monospaced so each character is five columns plus a space, then four more
+# frames to scroll the last off the display.
+FRAMES = len(TEXT) * 6 + 4
+SCROLLS = 5
+
+
+def scroll():
+    for i in range(SCROLLS):
+        display.scroll(TEXT, delay=0, monospace=True)
+
+
+measure("scroll_frames", FRAMES * SCROLLS, scroll)
+each("scroll_default_delay", 1, lambda i: display.scroll("Hi"))
+display.clear()
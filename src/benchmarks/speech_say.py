@@ -0,0 +1,6 @@
+# Speech synthesis. Audio plays in real time so this mostly measures how
+# closely synthesis keeps up.
+import speech
+from bench import each
+
+each("speech_say", 3, lambda i: speech.say("Hello world, I am a micro controller"))
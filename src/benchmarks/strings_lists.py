@@ -0,0 +1,47 @@
+# String and list work, which also exercises the GC.
+from bench import measure
+
+N = 2000
+
+
+def concat():
+    s = ""
+    for i in range(N):
+        s += str(i)
+        if len(s) > 200:
+            s = ""
+
+
+def format_join():
+    for i in range(N // 10):
+        ",".join(["{}:{}".format(j, j * j) for j in range(10)])
+
+
+def split_replace():
+    text = "the quick brown fox jumps over the lazy dog " * 4
+    for i in range(N // 10):
+        text.replace("fox", "cat").upper().split()
+
+
+def list_ops():
+    items = []
+    for i in range(N):
+        items.append(i * 7 % 13)
+    items.sort()
+    items.reverse()
+    sum(items[::2])
+
+
+def dict_ops():
+    d = {}
+    for i in range(N):
+        d[str(i % 100)] = i
+    for i in range(N):
+        d.get(str(i % 150), 0)
+
+
+measure("str_concat", N, concat)
+measure("str_format_join", N // 10, format_join)
+measure("str_split_replace", N // 10, split_replace)
+measure("list_append_sort", N, list_ops)
+measure("dict_set_get", N * 2, dict_ops)
@@ -25,6 +25,8 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "py/runtime.h"
 #include "py/mphal.h"
 #include "modbitsflow.h"
@@ -534,18 +536,15 @@ typedef struct _scrolling_string_iterator_t {
     mp_obj_base_t base;
     mp_obj_t ref;
     greyscale_t *img;
-    char const *next_char;
-    char const *start;
-    char const *end;
-    uint8_t offset;
-    uint8_t offset_limit;
-    bool monospace;
+    // The whole string rendered once, see scrolling_string_render.
+    uint8_t *strip;
+    size_t strip_len;
+    // The column after the rightmost one shown.
+    size_t pos;
     bool repeat;
-    char right;
 } scrolling_string_iterator_t;
 
 extern const mp_obj_type_t bitsflow_scrolling_string_type;
-extern const mp_obj_type_t bitsflow_scrolling_string_iterator_type;
 
 mp_obj_t scrolling_string_image_iterable(const char* str, mp_uint_t len, mp_obj_t ref, bool monospace, bool repeat) {
     scrolling_string_t *result = m_new_obj(scrolling_string_t);
@@ -578,20 +577,47 @@ STATIC unsigned int rightmost_non_blank_column(const unsigned char *font_data) {
     return 2;
 }
 
-static void restart(scrolling_string_iterator_t *iter) {
-    iter->next_char = iter->start;
-    iter->offset = 0;
-    if (iter->start < iter->end) {
-        iter->right = *iter->next_char;
-        if (iter->monospace) {
-            iter->offset_limit = 5;
-        } else {
-            iter->offset_limit = rightmost_non_blank_column(get_font_data_from_char(iter->right)) + 1;
+/* Renders the columns scrolled across the display, one byte per column with
+ * bit y set for a lit pixel in row y. Each character is followed by a blank
+ * column and the text by enough blank columns to scroll it off the display.
+ * Proportional characters after the first drop a blank leftmost column.
+ * With a NULL strip just counts the columns.
+ */
+STATIC size_t scrolling_string_render(const char *str, size_t len, bool monospace, uint8_t *strip) {
+    if (len == 0) {
+        if (strip != NULL) {
+            memset(strip, 0, BITSFLOW_DISPLAY_WIDTH);
+        }
+        return BITSFLOW_DISPLAY_WIDTH;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < len; ++i) {
+        const unsigned char *font_data = get_font_data_from_char(str[i]);
+        unsigned int start = 0;
+        unsigned int limit = BITSFLOW_DISPLAY_WIDTH;
+        if (!monospace) {
+            if (i > 0) {
+                start = !font_column_non_blank(font_data, 0);
+            }
+            limit = rightmost_non_blank_column(font_data) + 1;
+        }
+        for (unsigned int x = start; x <= limit; ++x) {
+            if (strip != NULL) {
+                uint8_t column = 0;
+                if (x < limit) {
+                    for (int y = 0; y < BITSFLOW_DISPLAY_HEIGHT; ++y) {
+                        column |= get_pixel_from_font_data(font_data, x, y) << y;
+                    }
+                }
+                strip[n] = column;
+            }
+            ++n;
         }
-    } else {
-        iter->right = ' ';
-        iter->offset_limit = 5;
     }
+    if (strip != NULL) {
+        memset(strip + n, 0, BITSFLOW_DISPLAY_WIDTH - 1);
+    }
+    return n + BITSFLOW_DISPLAY_WIDTH - 1;
 }
 
 STATIC mp_obj_t get_bitsflow_scrolling_string_iter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
@@ -600,59 +626,48 @@ STATIC mp_obj_t get_bitsflow_scrolling_string_iter(mp_obj_t o_in, mp_obj_iter_bu
     scrolling_string_iterator_t *result = m_new_obj(scrolling_string_iterator_t);
     result->base.type = &bitsflow_scrolling_string_iterator_type;
     result->img = greyscale_new(BITSFLOW_DISPLAY_WIDTH, BITSFLOW_DISPLAY_HEIGHT);
-    result->start = str->str;
     result->ref = str->ref;
-    result->monospace = str->monospace;
-    result->end = result->start + str->len;
     result->repeat = str->repeat;
-    restart(result);
+    // Rendered up front as frames may be drawn where we can't allocate.
+    result->strip_len = scrolling_string_render(str->str, str->len, str->monospace, NULL);
+    result->strip = m_new(uint8_t, result->strip_len);
+    scrolling_string_render(str->str, str->len, str->monospace, result->strip);
+    result->pos = 0;
     return result;
 }
 
-STATIC mp_obj_t bitsflow_scrolling_string_iter_next(mp_obj_t o_in) {
+bool scrolling_string_iter_next_frame(mp_obj_t o_in, uint8_t *frame) {
     scrolling_string_iterator_t *iter = (scrolling_string_iterator_t *)o_in;
-    if (iter->next_char == iter->end && iter->offset == 5) {
-        if (iter->repeat) {
-            restart(iter);
-            greyscale_clear(iter->img);
-        } else {
-            return MP_OBJ_STOP_ITERATION;
+    if (iter->pos == iter->strip_len) {
+        if (!iter->repeat) {
+            return false;
         }
+        // The strip ends blank so starting again looks like a cleared display.
+        iter->pos = 0;
     }
-    for (int x = 0; x < 4; x++) {
-        for (int y = 0; y < BITSFLOW_DISPLAY_HEIGHT; y++) {
-            greyscale_set_pixel(iter->img, x, y, greyscale_get_pixel(iter->img, x+1, y));
+    ++iter->pos;
+    for (int x = 0; x < BITSFLOW_DISPLAY_WIDTH; ++x) {
+        // Columns before the start of the strip are blank.
+        mp_int_t i = (mp_int_t)iter->pos - BITSFLOW_DISPLAY_WIDTH + x;
+        uint8_t column = i >= 0 ? iter->strip[i] : 0;
+        for (int y = 0; y < BITSFLOW_DISPLAY_HEIGHT; ++y) {
+            frame[y * BITSFLOW_DISPLAY_WIDTH + x] = ((column >> y) & 1) * BITSFLOW_DISPLAY_MAX_BRIGHTNESS;
         }
     }
-    for (int y = 0; y < BITSFLOW_DISPLAY_HEIGHT; y++) {
-        greyscale_set_pixel(iter->img, 4, y, 0);
+    return true;
+}
+
+STATIC mp_obj_t bitsflow_scrolling_string_iter_next(mp_obj_t o_in) {
+    scrolling_string_iterator_t *iter = (scrolling_string_iterator_t *)o_in;
+    uint8_t frame[BITSFLOW_DISPLAY_WIDTH * BITSFLOW_DISPLAY_HEIGHT];
+    if (!scrolling_string_iter_next_frame(o_in, frame)) {
+        return MP_OBJ_STOP_ITERATION;
     }
-    const unsigned char *font_data;
-    if (iter->offset < iter->offset_limit) {
-        font_data = get_font_data_from_char(iter->right);
-        for (int y = 0; y < BITSFLOW_DISPLAY_HEIGHT; ++y) {
-            int pix = get_pixel_from_font_data(font_data, iter->offset, y)*BITSFLOW_DISPLAY_MAX_BRIGHTNESS;
-            greyscale_set_pixel(iter->img, 4, y, pix);
-        }
-    } else if (iter->offset == iter->offset_limit) {
-        ++iter->next_char;
-        if (iter->next_char == iter->end) {
-            iter->right = ' ';
-            iter->offset_limit = 5;
-            iter->offset = 0;
-        } else {
-            iter->right = *iter->next_char;
-            font_data = get_font_data_from_char(iter->right);
-            if (iter->monospace) {
-                iter->offset = -1;
-                iter->offset_limit = 5;
-            } else {
-                iter->offset = -font_column_non_blank(font_data, 0);
-                iter->offset_limit = rightmost_non_blank_column(font_data)+1;
-            }
+    for (int y = 0; y < BITSFLOW_DISPLAY_HEIGHT; ++y) {
+        for (int x = 0; x < BITSFLOW_DISPLAY_WIDTH; ++x) {
+            greyscale_set_pixel(iter->img, x, y, frame[y * BITSFLOW_DISPLAY_WIDTH + x]);
         }
     }
-    ++iter->offset;
     return iter->img;
 }
 
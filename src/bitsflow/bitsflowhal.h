@@ -103,6 +103,8 @@ extern "C" {
 #define BITSFLOW_HAL_LOG_TIMESTAMP_DAYS             (864000)
 
 void bitsflow_hal_idle(void);
+// As bitsflow_hal_idle but a virtual clock never skips more than max_ms ahead.
+void bitsflow_hal_idle_for(uint32_t max_ms);
 
 void bitsflow_hal_reset(void);
 void bitsflow_hal_panic(int);
@@ -141,6 +143,8 @@ void bitsflow_hal_display_enable(int value);
 void bitsflow_hal_display_clear(void);
 int bitsflow_hal_display_get_pixel(int x, int y);
 void bitsflow_hal_display_set_pixel(int x, int y, int bright);
+// Sets all pixels from 25 brightness values in row-major order.
+void bitsflow_hal_display_set_frame(const uint8_t *frame);
 int bitsflow_hal_display_read_light_level(void);
 
 void bitsflow_hal_accelerometer_get_sample(int axis[3]);
@@ -167,6 +171,24 @@ int bitsflow_hal_log_begin_row(void);
 int bitsflow_hal_log_end_row(void);
 int bitsflow_hal_log_data(const char *key, const char *value);
 
+#define BITSFLOW_HAL_LOG_VALUE_INT (0)
+#define BITSFLOW_HAL_LOG_VALUE_STR (1)
+
+// A value in a row passed to bitsflow_hal_log_add_row.
+typedef struct _bitsflow_hal_log_value_t {
+    // The key as a qstr, or 0 if it isn't interned.
+    uint32_t key_qstr;
+    const char *key;
+    size_t key_len;
+    uint32_t type;
+    // The integer for BITSFLOW_HAL_LOG_VALUE_INT, otherwise the length of str.
+    int32_t value;
+    const char *str;
+} bitsflow_hal_log_value_t;
+
+// Adds a whole row, equivalent to begin_row, log_data for each value and end_row.
+int bitsflow_hal_log_add_row(const bitsflow_hal_log_value_t *values, size_t n);
+
 void bitsflow_hal_audio_select_pin(int pin);
 void bitsflow_hal_audio_select_speaker(bool enable);
 void bitsflow_hal_audio_set_volume(int value);
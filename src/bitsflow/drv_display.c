@@ -75,8 +75,24 @@ STATIC void wait_for_event() {
     wakeup_event = false;
 }
 
+// Like mp_iternext_allow_raise but scrolling text is drawn straight from its
+// strip, returning MP_OBJ_NULL.
+STATIC mp_obj_t animation_next(void) {
+    if (mp_obj_get_type(async_iterator) == &bitsflow_scrolling_string_iterator_type) {
+        uint8_t frame[BITSFLOW_DISPLAY_WIDTH * BITSFLOW_DISPLAY_HEIGHT];
+        if (!scrolling_string_iter_next_frame(async_iterator, frame)) {
+            return MP_OBJ_STOP_ITERATION;
+        }
+        bitsflow_hal_display_set_frame(frame);
+        return MP_OBJ_NULL;
+    }
+    return mp_iternext_allow_raise(async_iterator);
+}
+
 static void draw_object(mp_obj_t obj) {
-    if (obj == MP_OBJ_STOP_ITERATION) {
+    if (obj == MP_OBJ_NULL) {
+        // Already drawn.
+    } else if (obj == MP_OBJ_STOP_ITERATION) {
         if (async_clear) {
             bitsflow_display_show(BLANK_IMAGE);
             async_clear = false;
@@ -117,7 +133,7 @@ void bitsflow_display_update(void) {
             nlr_buf_t nlr;
             gc_lock();
             if (nlr_push(&nlr) == 0) {
-                obj = mp_iternext_allow_raise(async_iterator);
+                obj = animation_next();
                 nlr_pop();
                 gc_unlock();
             } else {
@@ -141,6 +157,17 @@ void bitsflow_display_update(void) {
     }
 }
 
+// Returns UINT32_MAX if there's no animation in progress.
+uint32_t bitsflow_display_get_ms_to_next_update(void) {
+    if (async_mode == ASYNC_MODE_STOPPED) {
+        return UINT32_MAX;
+    }
+    if (async_tick >= async_delay) {
+        return 0;
+    }
+    return async_delay - async_tick;
+}
+
 void bitsflow_display_clear(void) {
     wakeup_event = false;
     async_mode = ASYNC_MODE_CLEAR;
@@ -149,24 +176,16 @@ void bitsflow_display_clear(void) {
 }
 
 void bitsflow_display_show(bitsflow_image_obj_t *image) {
-    mp_int_t w = MIN(image_width(image), 5);
-    mp_int_t h = MIN(image_height(image), 5);
-    mp_int_t x = 0;
-    for (; x < w; ++x) {
-        mp_int_t y = 0;
-        for (; y < h; ++y) {
-            uint8_t pix = image_get_pixel(image, x, y);
-            bitsflow_hal_display_set_pixel(x, y, pix);
-        }
-        for (; y < 5; ++y) {
-            bitsflow_hal_display_set_pixel(x, y, 0);
-        }
-    }
-    for (; x < 5; ++x) {
-        for (mp_int_t y = 0; y < 5; ++y) {
-            bitsflow_hal_display_set_pixel(x, y, 0);
+    // Build the whole frame so the HAL is called once rather than per pixel.
+    uint8_t frame[BITSFLOW_DISPLAY_WIDTH * BITSFLOW_DISPLAY_HEIGHT] = {0};
+    mp_int_t w = MIN(image_width(image), BITSFLOW_DISPLAY_WIDTH);
+    mp_int_t h = MIN(image_height(image), BITSFLOW_DISPLAY_HEIGHT);
+    for (mp_int_t x = 0; x < w; ++x) {
+        for (mp_int_t y = 0; y < h; ++y) {
+            frame[y * BITSFLOW_DISPLAY_WIDTH + x] = image_get_pixel(image, x, y);
         }
     }
+    bitsflow_hal_display_set_frame(frame);
 }
 
 void bitsflow_display_scroll(const char *str) {
@@ -182,7 +201,7 @@ void bitsflow_display_animate(mp_obj_t iterable, mp_int_t delay, bool clear, boo
     async_clear = clear;
     MP_STATE_PORT(display_data) = async_iterator;
     wakeup_event = false;
-    mp_obj_t obj = mp_iternext_allow_raise(async_iterator);
+    mp_obj_t obj = animation_next();
     draw_object(obj);
     async_tick = 0;
     async_mode = ASYNC_MODE_ANIMATION;
@@ -38,6 +38,7 @@
 void bitsflow_display_init(void);
 void bitsflow_display_stop(void);
 void bitsflow_display_update(void);
+uint32_t bitsflow_display_get_ms_to_next_update(void);
 
 void bitsflow_display_clear(void);
 void bitsflow_display_show(bitsflow_image_obj_t *image);
@@ -102,4 +102,9 @@ bitsflow_image_obj_t *bitsflow_image_dim(bitsflow_image_obj_t *lhs, mp_float_t f
 // ref argument exists so that we can pull a string out of an object and not have it GC'ed while oterating over it
 mp_obj_t scrolling_string_image_iterable(const char* str, mp_uint_t len, mp_obj_t ref, bool monospace, bool repeat);
 
+// Fills frame with what the iterator's next image would be, without the image.
+// Returns false at the end. Doesn't allocate.
+extern const mp_obj_type_t bitsflow_scrolling_string_iterator_type;
+bool scrolling_string_iter_next_frame(mp_obj_t iter, uint8_t *frame);
+
 #endif // MICROPY_INCLUDED_CODAL_PORT_DRV_IMAGE_H
@@ -31,6 +31,12 @@
 
 #define TIMESTAMP_DEFAULT_FORMAT (BITSFLOW_HAL_LOG_TIMESTAMP_SECONDS)
 
+// Rows with up to this many values are passed to the HAL in one call.
+#define LOG_MAX_PACKED_VALUES (32)
+
+// Enough for str() of a single precision float.
+#define LOG_FLOAT_TEXT_LEN (24)
+
 STATIC void log_check_error(int result) {
     if (result == BITSFLOW_HAL_DEVICE_NO_RESOURCES) {
         mp_raise_OSError(MP_ENOSPC);
@@ -96,6 +102,56 @@ STATIC mp_obj_t log_delete(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(log_delete_obj, 0, log_delete);
 
+// Adds a row without allocating on the heap for small integers or floats.
+STATIC int log_add_packed(mp_map_t *map) {
+    bitsflow_hal_log_value_t values[LOG_MAX_PACKED_VALUES];
+    char float_text[LOG_MAX_PACKED_VALUES][LOG_FLOAT_TEXT_LEN];
+    size_t n = 0;
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (!mp_map_slot_is_filled(map, i)) {
+            continue;
+        }
+        bitsflow_hal_log_value_t *v = &values[n];
+
+        // Get key, which should be a string. The HAL caches keys by qstr.
+        mp_obj_t key = map->table[i].key;
+        v->key = mp_obj_str_get_data(key, &v->key_len);
+        if (mp_obj_is_qstr(key)) {
+            v->key_qstr = MP_OBJ_QSTR_VALUE(key);
+        } else {
+            v->key_qstr = qstr_find_strn(v->key, v->key_len);
+        }
+
+        // Small integers are formatted by the HAL. Floats are formatted here,
+        // as str() would, into a buffer on the stack.
+        mp_obj_t value = map->table[i].value;
+        if (mp_obj_is_small_int(value)) {
+            v->type = BITSFLOW_HAL_LOG_VALUE_INT;
+            v->value = MP_OBJ_SMALL_INT_VALUE(value);
+            v->str = NULL;
+        } else {
+            size_t len;
+            if (mp_obj_is_float(value)) {
+                vstr_t vstr;
+                vstr_init_fixed_buf(&vstr, LOG_FLOAT_TEXT_LEN, float_text[n]);
+                mp_print_t print = {&vstr, (mp_print_strn_t)vstr_add_strn};
+                mp_obj_print_helper(&print, value, PRINT_STR);
+                v->str = vstr.buf;
+                len = vstr.len;
+            } else {
+                if (mp_obj_is_integer(value)) {
+                    value = mp_obj_str_make_new(&mp_type_str, 1, 0, &value);
+                }
+                v->str = mp_obj_str_get_data(value, &len);
+            }
+            v->type = BITSFLOW_HAL_LOG_VALUE_STR;
+            v->value = len;
+        }
+        n++;
+    }
+    return bitsflow_hal_log_add_row(values, n);
+}
+
 STATIC mp_obj_t log_add(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     // Get the dict to add as a row.
     mp_map_t *map;
@@ -110,6 +166,11 @@ STATIC mp_obj_t log_add(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_ar
         mp_raise_ValueError(MP_ERROR_TEXT("too many arguments"));
     }
 
+    if (map->used <= LOG_MAX_PACKED_VALUES) {
+        log_check_error(log_add_packed(map));
+        return mp_const_none;
+    }
+
     // Add the log row.
     log_check_error(bitsflow_hal_log_begin_row());
     for (size_t i = 0; i < map->alloc; i++) {
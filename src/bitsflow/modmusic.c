@@ -132,6 +132,18 @@ void bitsflow_music_tick(void) {
     }
 }
 
+// Returns UINT32_MAX if no music is playing.
+uint32_t bitsflow_music_get_ms_to_next_tick(void) {
+    if (music_data == NULL || music_data->async_state == ASYNC_MUSIC_STATE_IDLE) {
+        return UINT32_MAX;
+    }
+    uint32_t ticks_ms = mp_hal_ticks_ms();
+    if (ticks_ms >= music_data->async_wait_ticks) {
+        return 0;
+    }
+    return music_data->async_wait_ticks - ticks_ms;
+}
+
 STATIC void wait_async_music_idle(void) {
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
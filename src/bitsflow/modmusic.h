@@ -53,5 +53,6 @@ extern const struct _mp_obj_tuple_t bitsflow_music_tune_power_down_obj;
 void bitsflow_music_volume_changed(void);
 bool bitsflow_music_is_playing(void);
 void bitsflow_music_tick(void);
+uint32_t bitsflow_music_get_ms_to_next_tick(void);
 
 #endif // MICROPY_INCLUDED_BITSFLOW_MUSIC_H
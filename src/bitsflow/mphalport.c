@@ -41,8 +41,9 @@ void mp_hal_delay_ms(mp_uint_t ms) {
         return;
     }
     uint32_t start = mp_hal_ticks_ms();
-    while (mp_hal_ticks_ms() - start < ms) {
+    uint32_t elapsed;
+    while ((elapsed = mp_hal_ticks_ms() - start) < ms) {
         mp_handle_pending(true);
-        bitsflow_hal_idle();
+        bitsflow_hal_idle_for(ms - elapsed);
     }
 }
@@ -26,6 +26,11 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
+#include "py/compile.h"
+#include "py/persistentcode.h"
+#include "py/reader.h"
 #include "py/stream.h"
 #include "py/runtime.h"
 #include "extmod/vfs.h"
@@ -39,6 +44,9 @@
 
 #define MAX_FILENAME_LENGTH (120)
 
+// Size of the buffer used when reading source files for import.
+#define FILE_READER_BUF_SIZE (128)
+
 /******************************************************************************/
 // os-level functions
 
@@ -188,17 +196,11 @@ STATIC mp_uint_t bitsflow_file_read(mp_obj_t self_in, void *buf_in, mp_uint_t si
         *errcode = MP_EBADF;
         return MP_STREAM_ERROR;
     }
-    uint32_t bytes_read = 0;
-    uint8_t *buf = buf_in;
-    while (size--) {
-        int chr = mp_js_hal_filesystem_readbyte(self->idx, self->offset);
-        if (chr < 0) {
-            break;
-        }
-        *buf++ = chr;
-        self->offset += 1;
-        bytes_read += 1;
+    int bytes_read = mp_js_hal_filesystem_read(self->idx, self->offset, buf_in, size);
+    if (bytes_read < 0) {
+        return 0;
     }
+    self->offset += bytes_read;
     return bytes_read;
 }
 
@@ -288,8 +290,36 @@ STATIC mbfs_file_obj_t *bitsflow_file_open(const char *name, size_t name_len, bo
 /******************************************************************************/
 // Import and reader interface
 
+STATIC bool has_suffix(const char *path, size_t len, const char *suffix) {
+    size_t suffix_len = strlen(suffix);
+    return len > suffix_len && strcmp(path + len - suffix_len, suffix) == 0;
+}
+
+// Finds x.py given x.mpy, also setting source to its name.
+STATIC int find_source_for_mpy(const char *path, size_t len, char source[MAX_FILENAME_LENGTH + 1]) {
+    if (len - 1 > MAX_FILENAME_LENGTH) {
+        return -1;
+    }
+    memcpy(source, path, len - 3);
+    strcpy(source + len - 3, "py");
+    return mp_js_hal_filesystem_find(source, len - 1);
+}
+
+// Imports go via the bytecode cache. We report x.py as missing so the import
+// falls back to x.mpy, which exists if x.py does, and mp_reader_new_file then
+// provides compiled code for x.py. As on the device, real .mpy files can't
+// be imported.
 mp_import_stat_t mp_import_stat(const char *path) {
-    int idx = mp_js_hal_filesystem_find(path, strlen(path));
+    size_t len = strlen(path);
+    int idx;
+    if (has_suffix(path, len, ".py")) {
+        idx = -1;
+    } else if (has_suffix(path, len, ".mpy")) {
+        char source[MAX_FILENAME_LENGTH + 1];
+        idx = find_source_for_mpy(path, len, source);
+    } else {
+        idx = mp_js_hal_filesystem_find(path, len);
+    }
     if (idx < 0) {
         return MP_IMPORT_STAT_NO_EXIST;
     } else {
@@ -297,33 +327,130 @@ mp_import_stat_t mp_import_stat(const char *path) {
     }
 }
 
-STATIC mp_uint_t file_readbyte(void *self_in) {
-    mbfs_file_obj_t *self = self_in;
-    int chr = mp_js_hal_filesystem_readbyte(self->idx, self->offset);
-    if (chr < 0) {
-        return MP_READER_EOF;
+// The lexer reads a byte at a time so we read ahead in chunks. Also used
+// for cached compiled code, so that isn't copied into the heap whole.
+typedef struct _file_reader_t {
+    int (*read)(int idx, size_t offset, uint8_t *buf, size_t len);
+    int idx;
+    size_t offset;
+    uint16_t len;
+    uint16_t pos;
+    uint8_t buf[FILE_READER_BUF_SIZE];
+} file_reader_t;
+
+STATIC mp_uint_t file_reader_readbyte(void *self_in) {
+    file_reader_t *self = self_in;
+    if (self->pos >= self->len) {
+        int len = self->read(self->idx, self->offset, self->buf, sizeof(self->buf));
+        if (len <= 0) {
+            return MP_READER_EOF;
+        }
+        self->offset += len;
+        self->len = len;
+        self->pos = 0;
     }
-    self->offset += 1;
-    return chr;
+    return self->buf[self->pos++];
 }
 
-STATIC void file_close(void *self_in) {
-    mbfs_file_obj_t *self = self_in;
-    self->open = false;
+STATIC void file_reader_close(void *self_in) {
+    m_del_obj(file_reader_t, self_in);
+}
+
+STATIC void file_reader_new(mp_reader_t *reader, int idx, int (*read)(int, size_t, uint8_t *, size_t)) {
+    file_reader_t *file_reader = m_new_obj(file_reader_t);
+    file_reader->read = read;
+    file_reader->idx = idx;
+    file_reader->offset = 0;
+    file_reader->len = 0;
+    file_reader->pos = 0;
+    reader->data = file_reader;
+    reader->readbyte = file_reader_readbyte;
+    reader->close = file_reader_close;
 }
 
 mp_lexer_t *mp_lexer_new_from_file(const char *filename) {
-    mbfs_file_obj_t *file = bitsflow_file_open(filename, strlen(filename), false, false);
-    if (file == NULL) {
+    size_t name_len = strlen(filename);
+    int idx = -1;
+    if (name_len <= MAX_FILENAME_LENGTH) {
+        idx = mp_js_hal_filesystem_find(filename, name_len);
+    }
+    if (idx < 0) {
         mp_raise_OSError(MP_ENOENT);
     }
     mp_reader_t reader;
-    reader.data = file;
-    reader.readbyte = file_readbyte;
-    reader.close = file_close;
+    file_reader_new(&reader, idx, mp_js_hal_filesystem_read);
     return mp_lexer_new(qstr_from_str(filename), reader);
 }
 
+typedef struct _bytecode_writer_t {
+    int idx;
+    size_t offset;
+} bytecode_writer_t;
+
+STATIC void bytecode_writer_strn(void *env, const char *str, size_t len) {
+    bytecode_writer_t *writer = env;
+    mp_js_hal_filesystem_bytecode_write(writer->idx, writer->offset, (const uint8_t *)str, len);
+    writer->offset += len;
+}
+
+// Compiles the file and adds the compiled code to the cache. It's saved
+// straight to JavaScript so the GC heap never holds a second copy.
+STATIC mp_raw_code_t *compile_file(int idx, const char *filename) {
+    mp_lexer_t *lex = mp_lexer_new_from_file(filename);
+    qstr source_name = lex->source_name;
+    mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+    mp_raw_code_t *raw_code = mp_compile_to_raw_code(&parse_tree, source_name, false);
+    bytecode_writer_t writer = { idx, 0 };
+    mp_print_t print = { &writer, bytecode_writer_strn };
+    mp_raw_code_save(raw_code, &print);
+    mp_js_hal_filesystem_bytecode_end(idx);
+    return raw_code;
+}
+
+// Reads the cached compiled code for the file, if there is any.
+STATIC bool read_cached_file(int idx, mp_reader_t *reader) {
+    if (mp_js_hal_filesystem_bytecode_size(idx) < 0) {
+        return false;
+    }
+    file_reader_new(reader, idx, mp_js_hal_filesystem_bytecode_read);
+    return true;
+}
+
+// Loads compiled code for a .py file. JavaScript keeps a cache of compiled code
+// keyed by file content, so files that haven't changed since a previous run or
+// flash aren't parsed and compiled again.
+mp_raw_code_t *bitsflow_fs_load_raw_code(const char *filename) {
+    int idx = mp_js_hal_filesystem_find(filename, strlen(filename));
+    if (idx < 0) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    mp_reader_t reader;
+    if (read_cached_file(idx, &reader)) {
+        return mp_raw_code_load(&reader);
+    }
+    return compile_file(idx, filename);
+}
+
+// Only used by import for x.mpy, to load the compiled code for x.py. See
+// mp_import_stat. The code keeps x.py as its source file for tracebacks.
+void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
+    char source[MAX_FILENAME_LENGTH + 1];
+    int idx = find_source_for_mpy(filename, strlen(filename), source);
+    if (idx < 0) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    if (!read_cached_file(idx, reader)) {
+        // Import loads from the reader, so on a miss we load what we've just
+        // saved. The code we compiled is garbage by then so the GC can free it
+        // as the load allocates.
+        compile_file(idx, source);
+        if (!read_cached_file(idx, reader)) {
+            // Only if the code is too big for the cache.
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+}
+
 /******************************************************************************/
 // Built-in open function
 
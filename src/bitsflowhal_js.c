@@ -6,7 +6,11 @@
 #include "shared/runtime/interrupt_char.h"
 #include "bitsflowhal.h"
 #include "bitsflowhal_js.h"
+#include "drv_display.h"
+#include "drv_softtimer.h"
+#include "modmusic.h"
 #include "jshal.h"
+#include "sound_synth.h"
 
 #define BITMAP_FONT_ASCII_START 32
 #define BITMAP_FONT_ASCII_END 126
@@ -17,10 +21,26 @@
 const unsigned char pendolino3[475] = {
 0x0, 0x0, 0x0, 0x0, 0x0, 0x8, 0x8, 0x8, 0x0, 0x8, 0xa, 0x4a, 0x40, 0x0, 0x0, 0xa, 0x5f, 0xea, 0x5f, 0xea, 0xe, 0xd9, 0x2e, 0xd3, 0x6e, 0x19, 0x32, 0x44, 0x89, 0x33, 0xc, 0x92, 0x4c, 0x92, 0x4d, 0x8, 0x8, 0x0, 0x0, 0x0, 0x4, 0x88, 0x8, 0x8, 0x4, 0x8, 0x4, 0x84, 0x84, 0x88, 0x0, 0xa, 0x44, 0x8a, 0x40, 0x0, 0x4, 0x8e, 0xc4, 0x80, 0x0, 0x0, 0x0, 0x4, 0x88, 0x0, 0x0, 0xe, 0xc0, 0x0, 0x0, 0x0, 0x0, 0x8, 0x0, 0x1, 0x22, 0x44, 0x88, 0x10, 0xc, 0x92, 0x52, 0x52, 0x4c, 0x4, 0x8c, 0x84, 0x84, 0x8e, 0x1c, 0x82, 0x4c, 0x90, 0x1e, 0x1e, 0xc2, 0x44, 0x92, 0x4c, 0x6, 0xca, 0x52, 0x5f, 0xe2, 0x1f, 0xf0, 0x1e, 0xc1, 0x3e, 0x2, 0x44, 0x8e, 0xd1, 0x2e, 0x1f, 0xe2, 0x44, 0x88, 0x10, 0xe, 0xd1, 0x2e, 0xd1, 0x2e, 0xe, 0xd1, 0x2e, 0xc4, 0x88, 0x0, 0x8, 0x0, 0x8, 0x0, 0x0, 0x4, 0x80, 0x4, 0x88, 0x2, 0x44, 0x88, 0x4, 0x82, 0x0, 0xe, 0xc0, 0xe, 0xc0, 0x8, 0x4, 0x82, 0x44, 0x88, 0xe, 0xd1, 0x26, 0xc0, 0x4, 0xe, 0xd1, 0x35, 0xb3, 0x6c, 0xc, 0x92, 0x5e, 0xd2, 0x52, 0x1c, 0x92, 0x5c, 0x92, 0x5c, 0xe, 0xd0, 0x10, 0x10, 0xe, 0x1c, 0x92, 0x52, 0x52, 0x5c, 0x1e, 0xd0, 0x1c, 0x90, 0x1e, 0x1e, 0xd0, 0x1c, 0x90, 0x10, 0xe, 0xd0, 0x13, 0x71, 0x2e, 0x12, 0x52, 0x5e, 0xd2, 0x52, 0x1c, 0x88, 0x8, 0x8, 0x1c, 0x1f, 0xe2, 0x42, 0x52, 0x4c, 0x12, 0x54, 0x98, 0x14, 0x92, 0x10, 0x10, 0x10, 0x10, 0x1e, 0x11, 0x3b, 0x75, 0xb1, 0x31, 0x11, 0x39, 0x35, 0xb3, 0x71, 0xc, 0x92, 0x52, 0x52, 0x4c, 0x1c, 0x92, 0x5c, 0x90, 0x10, 0xc, 0x92, 0x52, 0x4c, 0x86, 0x1c, 0x92, 0x5c, 0x92, 0x51, 0xe, 0xd0, 0xc, 0x82, 0x5c, 0x1f, 0xe4, 0x84, 0x84, 0x84, 0x12, 0x52, 0x52, 0x52, 0x4c, 0x11, 0x31, 0x31, 0x2a, 0x44, 0x11, 0x31, 0x35, 0xbb, 0x71, 0x12, 0x52, 0x4c, 0x92, 0x52, 0x11, 0x2a, 0x44, 0x84, 0x84, 0x1e, 0xc4, 0x88, 0x10, 0x1e, 0xe, 0xc8, 0x8, 0x8, 0xe, 0x10, 0x8, 0x4, 0x82, 0x41, 0xe, 0xc2, 0x42, 0x42, 0x4e, 0x4, 0x8a, 0x40, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x1f, 0x8, 0x4, 0x80, 0x0, 0x0, 0x0, 0xe, 0xd2, 0x52, 0x4f, 0x10, 0x10, 0x1c, 0x92, 0x5c, 0x0, 0xe, 0xd0, 0x10, 0xe, 0x2, 0x42, 0x4e, 0xd2, 0x4e, 0xc, 0x92, 0x5c, 0x90, 0xe, 0x6, 0xc8, 0x1c, 0x88, 0x8, 0xe, 0xd2, 0x4e, 0xc2, 0x4c, 0x10, 0x10, 0x1c, 0x92, 0x52, 0x8, 0x0, 0x8, 0x8, 0x8, 0x2, 0x40, 0x2, 0x42, 0x4c, 0x10, 0x14, 0x98, 0x14, 0x92, 0x8, 0x8, 0x8, 0x8, 0x6, 0x0, 0x1b, 0x75, 0xb1, 0x31, 0x0, 0x1c, 0x92, 0x52, 0x52, 0x0, 0xc, 0x92, 0x52, 0x4c, 0x0, 0x1c, 0x92, 0x5c, 0x90, 0x0, 0xe, 0xd2, 0x4e, 0xc2, 0x0, 0xe, 0xd0, 0x10, 0x10, 0x0, 0x6, 0xc8, 0x4, 0x98, 0x8, 0x8, 0xe, 0xc8, 0x7, 0x0, 0x12, 0x52, 0x52, 0x4f, 0x0, 0x11, 0x31, 0x2a, 0x44, 0x0, 0x11, 0x31, 0x35, 0xbb, 0x0, 0x12, 0x4c, 0x8c, 0x92, 0x0, 0x11, 0x2a, 0x44, 0x98, 0x0, 0x1e, 0xc4, 0x88, 0x1e, 0x6, 0xc4, 0x8c, 0x84, 0x86, 0x8, 0x8, 0x8, 0x8, 0x8, 0x18, 0x8, 0xc, 0x88, 0x18, 0x0, 0x0, 0xc, 0x83, 0x60};
 
+// Period of bitsflow_hal_timer_callback(), in milliseconds.
+#define TIMER_CALLBACK_PERIOD_MS (6)
+
 static uint16_t button_state[2];
 
+// With virtual time the clock skips ahead when idle rather than us sleeping.
+static bool virtual_time = false;
+static uint32_t timer_callback_last_ms = 0;
+
+// Busy programs yield to JavaScript once this much time has passed, as each
+// yield is an asyncify unwind and rewind, or in the blocking build a call to
+// run JavaScript timers. Set per run by the board.
+static uint32_t yield_budget_ms = 0;
+static uint32_t last_yield_ms = 0;
+
 void bitsflow_hal_init(void) {
     mp_js_hal_init();
+    virtual_time = mp_js_hal_virtual_time();
+    yield_budget_ms = mp_js_hal_yield_budget_ms();
+    last_yield_ms = mp_hal_ticks_ms();
 }
 
 // Sim only deinit.
@@ -29,39 +49,117 @@ void bitsflow_hal_deinit(void) {
     // Can be revisited if we stop/restart in way that resets WASM state.
     extern void bitsflow_radio_disable(void);
     bitsflow_radio_disable();
+    sound_synth_stop();
 
     mp_js_hal_deinit();
 }
 
-static void bitsflow_hal_process_events(void) {
+// Returns the current time, as read to process timer events.
+static uint32_t bitsflow_hal_process_events(void) {
     // Call bitsflow_hal_timer_callback() every 6ms.
-    static uint32_t last_ms = 0;
+    extern void bitsflow_hal_timer_callback(void);
     uint32_t ms = mp_hal_ticks_ms();
-    if (ms - last_ms >= 6) {
-        last_ms = ms;
-        extern void bitsflow_hal_timer_callback(void);
+    if (virtual_time) {
+        if ((int32_t)(ms - timer_callback_last_ms) < 0) {
+            // The clock was reset.
+            timer_callback_last_ms = ms;
+        }
+        // A skip can cover many periods. Call back for each of them so
+        // animations and music progress as they would in real time.
+        while (ms - timer_callback_last_ms >= TIMER_CALLBACK_PERIOD_MS) {
+            timer_callback_last_ms += TIMER_CALLBACK_PERIOD_MS;
+            bitsflow_hal_timer_callback();
+        }
+    } else if (ms - timer_callback_last_ms >= TIMER_CALLBACK_PERIOD_MS) {
+        timer_callback_last_ms = ms;
         bitsflow_hal_timer_callback();
     }
 
-    // Process stdin.
-    int c = mp_js_hal_stdin_pop_char();
-    if (c >= 0) {
-        if (c == mp_interrupt_char) {
-            mp_sched_keyboard_interrupt();
-        } else {
-            ringbuf_put(&stdin_ringbuf, c);
+    bitsflow_hal_stdin_refill();
+    return ms;
+}
+
+bool bitsflow_hal_stdin_refill(void) {
+    ringbuf_t *r = &stdin_ringbuf;
+    bool added = false;
+    // JavaScript copies straight into the free space, which takes up to two
+    // reads as it can wrap around the end of the ring.
+    for (int i = 0; i < 2; ++i) {
+        // A slot is left empty so a full ring differs from an empty one.
+        size_t end = r->iget > r->iput ? r->iget - 1 : r->iget == 0 ? r->size - 1 : r->size;
+        size_t len = end - r->iput;
+        if (len == 0) {
+            break;
+        }
+        uint8_t *buf = r->buf + r->iput;
+        size_t read = mp_js_hal_stdin_read(buf, len);
+        // Ctrl-C interrupts rather than being read so remove it.
+        size_t kept = 0;
+        for (size_t j = 0; j < read; ++j) {
+            if (buf[j] == mp_interrupt_char) {
+                mp_sched_keyboard_interrupt();
+            } else {
+                buf[kept++] = buf[j];
+            }
+        }
+        r->iput += kept;
+        if (r->iput == r->size) {
+            r->iput = 0;
+        }
+        added = added || kept > 0;
+        if (read < len) {
+            break;
         }
     }
+    return added;
+}
+
+static void bitsflow_hal_yield(uint32_t ms) {
+    #if BITSFLOW_BLOCKING
+    // The board runs its own timers and waits for input without returning
+    // to the event loop, so there's no asyncify unwind.
+    mp_js_hal_wait(ms);
+    #else
+    emscripten_sleep(ms);
+    #endif
+    last_yield_ms = mp_hal_ticks_ms();
 }
 
 void bitsflow_hal_background_processing(void) {
-    bitsflow_hal_process_events();
-    emscripten_sleep(0);
+    uint32_t ms = bitsflow_hal_process_events();
+    // Input and timers are processed above so this only delays UI updates
+    // and input arriving from JavaScript, by at most the budget.
+    if (ms - last_yield_ms >= yield_budget_ms) {
+        bitsflow_hal_yield(0);
+    }
+}
+
+// The time until the timer callback next has work to do, or UINT32_MAX if none.
+static uint32_t bitsflow_hal_get_ms_to_next_timer_event(void) {
+    uint32_t ms = bitsflow_soft_timer_get_ms_to_next_expiry();
+    ms = MIN(ms, bitsflow_display_get_ms_to_next_update());
+    ms = MIN(ms, bitsflow_music_get_ms_to_next_tick());
+    if (ms == UINT32_MAX) {
+        return ms;
+    }
+    // The work happens on the next timer callback after the deadline. Time
+    // passes while we process events, so that may already be due.
+    int32_t remaining = (int32_t)(timer_callback_last_ms + TIMER_CALLBACK_PERIOD_MS - mp_hal_ticks_ms());
+    return MAX(ms, (uint32_t)MAX(remaining, 0));
 }
 
 void bitsflow_hal_idle(void) {
+    bitsflow_hal_idle_for(UINT32_MAX);
+}
+
+void bitsflow_hal_idle_for(uint32_t max_ms) {
     bitsflow_hal_process_events();
-    emscripten_sleep(5);
+    if (virtual_time && mp_js_hal_skip_ms(MIN(max_ms, bitsflow_hal_get_ms_to_next_timer_event()))) {
+        // Still yield so input and any JavaScript timers that are now due are processed.
+        bitsflow_hal_yield(0);
+    } else {
+        bitsflow_hal_yield(5);
+    }
 }
 
 void bitsflow_hal_reset(void) {
@@ -313,6 +411,10 @@ void bitsflow_hal_display_set_pixel(int x, int y, int bright) {
     mp_js_hal_display_set_pixel(x, y, bright);
 }
 
+void bitsflow_hal_display_set_frame(const uint8_t *frame) {
+    mp_js_hal_display_set_frame(frame);
+}
+
 int bitsflow_hal_display_read_light_level(void) {
     return mp_js_hal_display_read_light_level();
 }
@@ -389,6 +491,10 @@ int bitsflow_hal_log_data(const char *key, const char *value) {
     return mp_js_hal_log_data(key, value);
 }
 
+int bitsflow_hal_log_add_row(const bitsflow_hal_log_value_t *values, size_t n) {
+    return mp_js_hal_log_add_row(values, n);
+}
+
 // This is used to seed the random number generator.
 uint32_t rng_generate_random_word(void) {
     return mp_js_rng_generate_random_word();
@@ -418,18 +524,23 @@ void bitsflow_hal_audio_set_volume(int value) {
 
 void bitsflow_hal_sound_synth_callback(int event) {
     // We don't use this callback. Instead bitsflow_hal_audio_is_expression_active
-    // calls through to JS which has this state.
+    // checks the synthesizer in sound_synth.c.
 }
 
 bool bitsflow_hal_audio_is_expression_active(void) {
-    return mp_js_hal_audio_is_expression_active();
+    return sound_synth_is_active();
 }
 
 void bitsflow_hal_audio_play_expression(const char *expr) {
-    mp_js_hal_audio_play_expression(expr);
+    sound_synth_play(expr);
+    if (sound_synth_is_active()) {
+        // JavaScript pulls the audio as it needs it.
+        mp_js_hal_audio_play_expression(sound_synth_buffer(), SOUND_SYNTH_SAMPLE_RATE);
+    }
 }
 
 void bitsflow_hal_audio_stop_expression(void) {
+    sound_synth_stop();
     mp_js_hal_audio_stop_expression();
 }
 
@@ -1,3 +1,6 @@
 void bitsflow_hal_init(void);
 void bitsflow_hal_deinit(void);
 void bitsflow_hal_background_processing(void);
+// Reads serial input from JavaScript into stdin_ringbuf, returning true if
+// there was any.
+bool bitsflow_hal_stdin_refill(void);
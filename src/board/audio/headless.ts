@@ -0,0 +1,234 @@
+import { AudioOptions } from ".";
+import { Clock } from "../clock";
+import { AudioRing } from "./ring";
+
+/**
+ * Somewhere to play the headless board's audio. The worker board uses the
+ * page's audio worklet.
+ */
+export interface AudioOutput {
+  /**
+   * For the default, speech and sound expression audio.
+   */
+  rings: AudioRing[];
+  setVolume(volume: number): void;
+  setPeriodUs(periodUs: number): void;
+  setAmplitudeU10(amplitudeU10: number): void;
+}
+
+type HeadlessChannel = HeadlessBufferedAudio | HeadlessRingAudio;
+
+/**
+ * Audio for the headless board.
+ *
+ * Without an output nothing is played but buffers are consumed at the rate
+ * real audio hardware would consume them so programs that wait on audio or
+ * speech take the same amount of time as they do in the browser.
+ */
+export class HeadlessAudio {
+  default: HeadlessChannel | undefined;
+  speech: HeadlessChannel | undefined;
+  soundExpression: HeadlessChannel | undefined;
+  currentSoundExpressionCallback: undefined | (() => void);
+  /**
+   * Takes effect from the next initializeCallbacks.
+   */
+  output: AudioOutput | undefined;
+
+  constructor(private clock: Clock) {}
+
+  initializeCallbacks({
+    defaultAudioCallback,
+    speechAudioCallback,
+  }: AudioOptions) {
+    const callbacks = [
+      defaultAudioCallback,
+      speechAudioCallback,
+      () => {
+        if (this.currentSoundExpressionCallback) {
+          this.currentSoundExpressionCallback();
+        }
+      },
+    ];
+    const rings = this.output?.rings;
+    [this.default, this.speech, this.soundExpression] = callbacks.map(
+      (callback, i) =>
+        rings
+          ? new HeadlessRingAudio(this.clock, rings[i], callback)
+          : new HeadlessBufferedAudio(this.clock, callback)
+    );
+  }
+
+  playSoundExpression(sampleRate: number, pull: () => Float32Array) {
+    const callback = () => {
+      const samples = pull();
+      if (samples.length === 0) {
+        this.stopSoundExpression();
+      } else {
+        this.soundExpression!.init(sampleRate);
+        this.soundExpression!.writeSamples(samples);
+      }
+    };
+    this.currentSoundExpressionCallback = callback;
+    callback();
+  }
+
+  stopSoundExpression(): void {
+    this.currentSoundExpressionCallback = undefined;
+  }
+
+  mute() {}
+
+  unmute() {}
+
+  setVolume(volume: number) {
+    this.output?.setVolume(volume);
+  }
+
+  setPeriodUs(periodUs: number) {
+    this.output?.setPeriodUs(periodUs);
+  }
+
+  setAmplitudeU10(amplitudeU10: number) {
+    this.output?.setAmplitudeU10(amplitudeU10);
+  }
+
+  boardStopped() {
+    this.stopSoundExpression();
+    this.speech?.dispose();
+    this.soundExpression?.dispose();
+    this.default?.dispose();
+  }
+}
+
+/**
+ * Enough of AudioBuffer for conversions.convertAudioBuffer.
+ */
+class HeadlessAudioBuffer {
+  private data: Float32Array;
+
+  constructor(public length: number, public sampleRate: number) {
+    this.data = new Float32Array(length);
+  }
+
+  getChannelData(channel: number) {
+    return this.data;
+  }
+}
+
+class HeadlessBufferedAudio {
+  private nextStartTime: number = -1;
+  private sampleRate: number = -1;
+  private timeouts = new Set<any>();
+
+  constructor(private clock: Clock, private callback: () => void) {}
+
+  init(sampleRate: number) {
+    this.sampleRate = sampleRate;
+  }
+
+  createBuffer(length: number) {
+    return new HeadlessAudioBuffer(length, this.sampleRate);
+  }
+
+  writeSamples(samples: Float32Array) {
+    // Only the length matters.
+    this.writeData(this.createBuffer(samples.length));
+  }
+
+  writeData(buffer: HeadlessAudioBuffer) {
+    // Mirrors BufferedAudio's scheduling, with a timeout standing in for
+    // the AudioBufferSourceNode's ended event.
+    const currentTime = this.clock.now();
+    const first = this.nextStartTime < currentTime;
+    const startTime = first ? currentTime : this.nextStartTime;
+    this.nextStartTime =
+      startTime + (buffer.length / buffer.sampleRate) * 1000;
+    if (first) {
+      // We're just getting started so buffer another frame.
+      this.callback();
+    }
+    const timeout = this.clock.setTimeout(() => {
+      this.timeouts.delete(timeout);
+      this.callback();
+    }, this.nextStartTime - currentTime);
+    this.timeouts.add(timeout);
+  }
+
+  dispose() {
+    // Prevent calls into WASM when the pending buffers finish.
+    this.callback = () => {};
+    this.timeouts.forEach((timeout) => this.clock.clearTimeout(timeout));
+    this.timeouts.clear();
+    this.nextStartTime = -1;
+  }
+}
+
+/**
+ * Writes to a ring that's played elsewhere, asking for more when the ring
+ * runs low as RingBufferedAudio does when the worklet asks.
+ *
+ * The worklet's requests go to the page, so a timeout checks the fill
+ * level instead.
+ */
+class HeadlessRingAudio {
+  private sampleRate: number = -1;
+  private buffer: HeadlessAudioBuffer | undefined;
+  private timeout: any;
+
+  constructor(
+    private clock: Clock,
+    private ring: AudioRing,
+    private callback: () => void
+  ) {}
+
+  init(sampleRate: number) {
+    this.sampleRate = sampleRate;
+    this.ring.setSampleRate(sampleRate);
+  }
+
+  createBuffer(length: number) {
+    // Reused as writeData copies it to the ring.
+    if (
+      !this.buffer ||
+      this.buffer.length !== length ||
+      this.buffer.sampleRate !== this.sampleRate
+    ) {
+      this.buffer = new HeadlessAudioBuffer(length, this.sampleRate);
+    }
+    return this.buffer;
+  }
+
+  writeSamples(samples: Float32Array) {
+    // If the ring is full we're too far ahead to keep this anyway.
+    this.ring.write(samples);
+    if (this.timeout === undefined) {
+      this.scheduleRequest();
+    }
+  }
+
+  writeData(buffer: HeadlessAudioBuffer) {
+    this.writeSamples(buffer.getChannelData(0));
+  }
+
+  dispose() {
+    // Prevent calls into WASM once the ring drains.
+    this.callback = () => {};
+    if (this.timeout !== undefined) {
+      this.clock.clearTimeout(this.timeout);
+      this.timeout = undefined;
+    }
+  }
+
+  private scheduleRequest() {
+    this.timeout = this.clock.setTimeout(() => {
+      this.timeout = undefined;
+      if (this.ring.msUntilLow() > 0) {
+        // The consumer is slower than our clock.
+        this.scheduleRequest();
+      } else {
+        this.callback();
+      }
+    }, this.ring.msUntilLow());
+  }
+}
@@ -1,6 +1,4 @@
-import { replaceBuiltinSound } from "./built-in-sounds";
-import { SoundEmojiSynthesizer } from "./sound-emoji-synthesizer";
-import { parseSoundEffects } from "./sound-expressions";
+import { AudioRing } from "./ring";
 
 declare global {
   interface Window {
@@ -8,7 +6,33 @@ declare global {
   }
 }
 
-interface AudioOptions {
+// Relative to the page. The dist build rewrites this to the content-hashed
+// name.
+const audioWorkletUrl = "./build/audio-worklet.js";
+
+/**
+ * Loads the worklet that plays audio from rings in shared memory.
+ *
+ * @returns false if that isn't supported, when we play buffers via nodes.
+ */
+const loadAudioWorklet = async (context: AudioContext): Promise<boolean> => {
+  if (
+    !context.audioWorklet ||
+    typeof SharedArrayBuffer === "undefined" ||
+    !window.crossOriginIsolated
+  ) {
+    return false;
+  }
+  try {
+    await context.audioWorklet.addModule(audioWorkletUrl);
+    return true;
+  } catch (e) {
+    console.error(e);
+    return false;
+  }
+};
+
+export interface AudioOptions {
   defaultAudioCallback: () => void;
   speechAudioCallback: () => void;
 }
@@ -21,10 +45,12 @@ export class Audio {
   private oscillator: OscillatorNode | undefined;
   private volumeNode: GainNode | undefined;
   private muteNode: GainNode | undefined;
+  private workletLoaded: Promise<boolean> | undefined;
+  private worklet: RingWorklet | undefined;
 
-  default: BufferedAudio | undefined;
-  speech: BufferedAudio | undefined;
-  soundExpression: BufferedAudio | undefined;
+  default: BufferedAudio | RingBufferedAudio | undefined;
+  speech: BufferedAudio | RingBufferedAudio | undefined;
+  soundExpression: BufferedAudio | RingBufferedAudio | undefined;
   currentSoundExpressionCallback: undefined | (() => void);
 
   constructor() { }
@@ -33,37 +59,41 @@ export class Audio {
     defaultAudioCallback,
     speechAudioCallback,
   }: AudioOptions) {
-    if (!this.context) {
-      throw new Error("Context must be pre-created from a user event");
-    }
-    this.muteNode = this.context.createGain();
-    this.muteNode.gain.setValueAtTime(
-      this.muted ? 0 : 1,
-      this.context.currentTime
-    );
-    this.muteNode.connect(this.context.destination);
-    this.volumeNode = this.context.createGain();
-    this.volumeNode.connect(this.muteNode);
-
-    this.default = new BufferedAudio(
-      this.context,
-      this.volumeNode,
-      () => { if (defaultAudioCallback) defaultAudioCallback(); }
-    );
-    this.speech = new BufferedAudio(
-      this.context,
-      this.volumeNode,
-      () => { if (speechAudioCallback) speechAudioCallback(); }
-    );
-    this.soundExpression = new BufferedAudio(
-      this.context,
-      this.volumeNode,
+    this.initializeNodes();
+    const callbacks = [
+      () => {
+        if (defaultAudioCallback) defaultAudioCallback();
+      },
+      () => {
+        if (speechAudioCallback) speechAudioCallback();
+      },
       () => {
         if (this.currentSoundExpressionCallback) {
           this.currentSoundExpressionCallback();
         }
-      }
-    );
+      },
+    ];
+    if (this.worklet) {
+      [this.default, this.speech, this.soundExpression] =
+        this.worklet.createChannels(callbacks);
+    } else {
+      [this.default, this.speech, this.soundExpression] = callbacks.map(
+        (callback) =>
+          new BufferedAudio(this.context!, this.volumeNode!, callback)
+      );
+    }
+  }
+
+  /**
+   * Plays audio written to the worklet's rings by firmware in a worker,
+   * rather than by the firmware here.
+   *
+   * @returns the rings' buffers, or undefined if there's no worklet.
+   */
+  initializeWorker(): SharedArrayBuffer[] | undefined {
+    this.initializeNodes();
+    this.default = this.speech = this.soundExpression = undefined;
+    return this.worklet?.release();
   }
 
   async createAudioContextFromUserInteraction(): Promise<void> {
@@ -73,34 +103,33 @@ export class Audio {
         // The highest rate is the sound expression synth.
         sampleRate: 44100,
       });
-    if (this.context.state === "suspended") {
-      return this.context.resume();
+    // Resume first as it must happen in the user event.
+    const resumed =
+      this.context.state === "suspended" ? this.context.resume() : undefined;
+    if (!this.workletLoaded) {
+      const context = this.context;
+      this.workletLoaded = loadAudioWorklet(context).then((loaded) => {
+        if (loaded) {
+          this.worklet = new RingWorklet(context);
+        }
+        return loaded;
+      });
     }
+    await Promise.all([resumed, this.workletLoaded]);
   }
 
-  playSoundExpression(expr: string) {
-    const soundEffects = parseSoundEffects(replaceBuiltinSound(expr));
-    const onDone = () => {
-      this.stopSoundExpression();
-    };
-    const synth = new SoundEmojiSynthesizer(0, onDone);
-    synth.play(soundEffects);
-
+  /**
+   * @param pull Synthesizes the next buffer of the expression. Empty when
+   * it has finished.
+   */
+  playSoundExpression(sampleRate: number, pull: () => Float32Array) {
     const callback = () => {
-      const source = synth.pull();
-      if (this.context) {
-        // Use createBuffer instead of new AudioBuffer to support Safari 14.0.
-        const target = this.context.createBuffer(
-          1,
-          source.length,
-          synth.sampleRate
-        );
-        const channel = target.getChannelData(0);
-        for (let i = 0; i < source.length; i++) {
-          // Buffer is (0, 1023) we need to map it to (-1, 1)
-          channel[i] = (source[i] - 512) / 512;
-        }
-        this.soundExpression!.writeData(target);
+      const samples = pull();
+      if (samples.length === 0) {
+        this.stopSoundExpression();
+      } else if (this.soundExpression) {
+        this.soundExpression.init(sampleRate);
+        this.soundExpression.writeSamples(samples);
       }
     };
     this.currentSoundExpressionCallback = callback;
@@ -111,10 +140,6 @@ export class Audio {
     this.currentSoundExpressionCallback = undefined;
   }
 
-  isSoundExpressionActive(): boolean {
-    return !!this.currentSoundExpressionCallback;
-  }
-
   mute() {
     this.muted = true;
     if (this.muteNode) {
@@ -162,6 +187,27 @@ export class Audio {
     this.default?.dispose();
   }
 
+  private initializeNodes() {
+    if (!this.context) {
+      throw new Error("Context must be pre-created from a user event");
+    }
+    // Called for each run, so replace the previous run's nodes.
+    this.muteNode?.disconnect();
+    this.muteNode = this.context.createGain();
+    this.muteNode.gain.setValueAtTime(
+      this.muted ? 0 : 1,
+      this.context.currentTime
+    );
+    this.muteNode.connect(this.context.destination);
+    this.volumeNode = this.context.createGain();
+    this.volumeNode.connect(this.muteNode);
+    if (this.worklet) {
+      // The worklet outlives the module so reconnect it.
+      this.worklet.node.disconnect();
+      this.worklet.node.connect(this.volumeNode);
+    }
+  }
+
   private stopOscillator() {
     if (this.oscillator) {
       this.oscillator.stop();
@@ -190,6 +236,12 @@ class BufferedAudio {
     return this.context.createBuffer(1, length, this.sampleRate);
   }
 
+  writeSamples(samples: Float32Array) {
+    const buffer = this.createBuffer(samples.length);
+    buffer.getChannelData(0).set(samples);
+    this.writeData(buffer);
+  }
+
   writeData(buffer: AudioBuffer) {
     // Use createBufferSource instead of new AudioBufferSourceNode to support Safari 14.0.
     const source = this.context.createBufferSource();
@@ -213,3 +265,108 @@ class BufferedAudio {
     this.callback = () => { };
   }
 }
+
+/**
+ * Plays the default, speech and sound expression audio from rings in shared
+ * memory on the audio thread. See audio-worklet.ts.
+ *
+ * The worklet asks for more audio as each ring drains. Unlike BufferedAudio
+ * this doesn't need a node or a callback per chunk.
+ */
+class RingWorklet {
+  readonly node: AudioWorkletNode;
+  private rings = [new AudioRing(), new AudioRing(), new AudioRing()];
+  private channels: RingBufferedAudio[] = [];
+
+  constructor(context: AudioContext) {
+    this.node = new AudioWorkletNode(context, "ring-processor", {
+      numberOfInputs: 0,
+      outputChannelCount: [1],
+      processorOptions: {
+        buffers: this.rings.map((ring) => ring.buffer),
+      },
+    });
+    this.node.port.onmessage = (e: MessageEvent) => {
+      this.channels[e.data]?.requestData();
+    };
+  }
+
+  /**
+   * Replaces the channels. Any audio still in the rings plays out.
+   */
+  createChannels(callbacks: Array<() => void>): RingBufferedAudio[] {
+    this.channels.forEach((channel) => channel.dispose());
+    this.channels = this.rings.map(
+      (ring, i) => new RingBufferedAudio(ring, callbacks[i])
+    );
+    return this.channels;
+  }
+
+  /**
+   * Removes the channels so something else can write to the rings.
+   *
+   * @returns the rings' buffers.
+   */
+  release(): SharedArrayBuffer[] {
+    this.channels.forEach((channel) => channel.dispose());
+    this.channels = [];
+    return this.rings.map((ring) => ring.buffer);
+  }
+}
+
+/**
+ * Enough of AudioBuffer for conversions.convertAudioBuffer.
+ */
+class RingAudioBuffer {
+  private data: Float32Array;
+
+  constructor(public length: number, public sampleRate: number) {
+    this.data = new Float32Array(length);
+  }
+
+  getChannelData(channel: number) {
+    return this.data;
+  }
+}
+
+class RingBufferedAudio {
+  private sampleRate: number = -1;
+  private buffer: RingAudioBuffer | undefined;
+
+  constructor(private ring: AudioRing, private callback: () => void) {}
+
+  init(sampleRate: number) {
+    this.sampleRate = sampleRate;
+    this.ring.setSampleRate(sampleRate);
+  }
+
+  createBuffer(length: number) {
+    // Reused as writeData copies it to the ring.
+    if (
+      !this.buffer ||
+      this.buffer.length !== length ||
+      this.buffer.sampleRate !== this.sampleRate
+    ) {
+      this.buffer = new RingAudioBuffer(length, this.sampleRate);
+    }
+    return this.buffer;
+  }
+
+  writeSamples(samples: Float32Array) {
+    // If the ring is full we're too far ahead to keep this anyway.
+    this.ring.write(samples);
+  }
+
+  writeData(buffer: RingAudioBuffer) {
+    this.writeSamples(buffer.getChannelData(0));
+  }
+
+  requestData() {
+    this.callback();
+  }
+
+  dispose() {
+    // Prevent calls into WASM when the worklet asks for more.
+    this.callback = () => {};
+  }
+}
@@ -0,0 +1,60 @@
+import { describe, expect, it } from "vitest";
+import { AudioRing } from "./ring";
+
+const mix = (ring: AudioRing, length: number, sampleRate: number) => {
+  const output = new Float32Array(length);
+  ring.mixInto(output, sampleRate);
+  return Array.from(output);
+};
+
+describe("AudioRing", () => {
+  it("plays samples at the output rate", () => {
+    const producer = new AudioRing();
+    const consumer = new AudioRing(producer.buffer);
+    producer.setSampleRate(100);
+    producer.write(new Float32Array([0.25, 0.5, 0.75]));
+    expect(mix(consumer, 3, 100)).toEqual([0.25, 0.5, 0.75]);
+    // Silence when it runs out.
+    expect(mix(consumer, 2, 100)).toEqual([0, 0]);
+  });
+
+  it("interpolates when resampling", () => {
+    const producer = new AudioRing();
+    const consumer = new AudioRing(producer.buffer);
+    producer.setSampleRate(50);
+    producer.write(new Float32Array([0, 0.5, 1]));
+    expect(mix(consumer, 5, 100)).toEqual([0, 0.25, 0.5, 0.75, 1]);
+  });
+
+  it("requests more once per write when low", () => {
+    const producer = new AudioRing();
+    const consumer = new AudioRing(producer.buffer);
+    // Nothing to ask for until a source starts.
+    expect(consumer.shouldRequest()).toEqual(false);
+    producer.setSampleRate(1000);
+    expect(consumer.shouldRequest()).toEqual(true);
+    expect(consumer.shouldRequest()).toEqual(false);
+    producer.write(new Float32Array(10));
+    expect(consumer.shouldRequest()).toEqual(true);
+    producer.write(new Float32Array(100));
+    expect(consumer.shouldRequest()).toEqual(false);
+  });
+
+  it("says when it will run low", () => {
+    const producer = new AudioRing();
+    producer.setSampleRate(1000);
+    expect(producer.msUntilLow()).toEqual(0);
+    producer.write(new Float32Array(150));
+    expect(producer.msUntilLow()).toBeCloseTo(100);
+    const consumer = new AudioRing(producer.buffer);
+    mix(consumer, 125, 1000);
+    expect(producer.msUntilLow()).toEqual(0);
+  });
+
+  it("writes what fits when full", () => {
+    const ring = new AudioRing();
+    const chunk = new Float32Array(40000);
+    expect(ring.write(chunk)).toEqual(40000);
+    expect(ring.write(chunk)).toEqual(65536 - 40000);
+  });
+});
@@ -0,0 +1,126 @@
+/**
+ * A single producer, single consumer ring of audio samples in a
+ * SharedArrayBuffer.
+ *
+ * The main thread writes samples at the sample rate of the source and the
+ * audio worklet (see audio-worklet.ts) mixes them into its output,
+ * resampling as it goes. When the ring runs low the worklet asks for more,
+ * at most once per write, so refills follow the fill level rather than
+ * the completion of each chunk.
+ */
+
+// In samples. Must be a power of two. Over a second for every source.
+const capacity = 65536;
+// How much audio we try to keep buffered, in seconds.
+const bufferedSeconds = 0.05;
+
+// Int32 offsets into the header.
+const readSlot = 0;
+const writeSlot = 1;
+const requestedSlot = 2;
+const sampleRateSlot = 3;
+const headerBytes = 4 * 4;
+
+export class AudioRing {
+  private header: Int32Array;
+  private data: Float32Array;
+
+  // Consumer state. How far we are between the sample at the read index and
+  // the next one, for resampling.
+  private position = 0;
+
+  constructor(
+    readonly buffer: SharedArrayBuffer = new SharedArrayBuffer(
+      headerBytes + capacity * 4
+    )
+  ) {
+    this.header = new Int32Array(buffer, 0, headerBytes / 4);
+    this.data = new Float32Array(buffer, headerBytes, capacity);
+  }
+
+  // Producer.
+
+  setSampleRate(sampleRate: number) {
+    Atomics.store(this.header, sampleRateSlot, sampleRate);
+  }
+
+  /**
+   * @returns the number of samples written, less than given if it's full.
+   */
+  write(samples: Float32Array): number {
+    const write = Atomics.load(this.header, writeSlot);
+    const read = Atomics.load(this.header, readSlot);
+    const length = Math.min(samples.length, capacity - ((write - read) | 0));
+    for (let i = 0; i < length; ++i) {
+      this.data[(write + i) & (capacity - 1)] = samples[i];
+    }
+    Atomics.store(this.header, writeSlot, (write + length) | 0);
+    // Allows the consumer to ask again.
+    Atomics.store(this.header, requestedSlot, 0);
+    return length;
+  }
+
+  /**
+   * @returns how long until the ring is low enough that the consumer would
+   * ask for more, in milliseconds. Zero if it already is.
+   */
+  msUntilLow(): number {
+    const sampleRate = Atomics.load(this.header, sampleRateSlot);
+    const buffered =
+      (Atomics.load(this.header, writeSlot) -
+        Atomics.load(this.header, readSlot)) |
+      0;
+    return sampleRate > 0
+      ? Math.max(0, (buffered / sampleRate - bufferedSeconds) * 1000)
+      : 0;
+  }
+
+  // Consumer.
+
+  /**
+   * Adds the buffered audio to the output, resampled to its sample rate.
+   * Outputs silence for any shortfall.
+   */
+  mixInto(output: Float32Array, outputSampleRate: number) {
+    const sampleRate = Atomics.load(this.header, sampleRateSlot);
+    const write = Atomics.load(this.header, writeSlot);
+    let read = Atomics.load(this.header, readSlot);
+    const step = sampleRate / outputSampleRate;
+    for (let i = 0; i < output.length && read !== write; ++i) {
+      // Linear interpolation, holding the last sample if we're running out.
+      const current = this.data[read & (capacity - 1)];
+      const next =
+        ((write - read) | 0) > 1
+          ? this.data[(read + 1) & (capacity - 1)]
+          : current;
+      output[i] += current + (next - current) * this.position;
+      this.position += step;
+      while (this.position >= 1 && read !== write) {
+        read = (read + 1) | 0;
+        this.position -= 1;
+      }
+    }
+    if (read === write) {
+      // Start afresh when there's more.
+      this.position = 0;
+    }
+    Atomics.store(this.header, readSlot, read);
+  }
+
+  /**
+   * @returns true if the producer should be asked for more audio. Only
+   * returns true once until the next write.
+   */
+  shouldRequest(): boolean {
+    const sampleRate = Atomics.load(this.header, sampleRateSlot);
+    const buffered =
+      (Atomics.load(this.header, writeSlot) -
+        Atomics.load(this.header, readSlot)) |
+      0;
+    return (
+      sampleRate > 0 &&
+      buffered < sampleRate * bufferedSeconds &&
+      Atomics.compareExchange(this.header, requestedSlot, 0, 1) === 0
+    );
+  }
+}
@@ -14,16 +14,18 @@ export class Button {
 
   constructor(
     private id: "buttonA" | "buttonB",
-    private element: SVGElement,
-    private label: () => string,
+    private ui: { element: SVGElement; label: () => string } | null,
     private onChange: (change: Partial<State>) => void
   ) {
     this._presses = 0;
     this.state = new RangeSensor(id, 0, 1, 0, undefined);
 
-    this.element.setAttribute("role", "button");
-    this.element.setAttribute("tabindex", "0");
-    this.element.style.cursor = "pointer";
+    if (this.ui) {
+      const { element } = this.ui;
+      element.setAttribute("role", "button");
+      element.setAttribute("tabindex", "0");
+      element.style.cursor = "pointer";
+    }
 
     this.keyListener = (e) => {
       switch (e.key) {
@@ -59,17 +61,22 @@ export class Button {
       }
     };
 
-    this.element.addEventListener("mousedown", this.mouseDownListener);
-    this.element.addEventListener("touchstart", this.touchStartListener);
-    this.element.addEventListener("mouseup", this.mouseUpTouchEndListener);
-    this.element.addEventListener("touchend", this.mouseUpTouchEndListener);
-    this.element.addEventListener("keydown", this.keyListener);
-    this.element.addEventListener("keyup", this.keyListener);
-    this.element.addEventListener("mouseleave", this.mouseLeaveListener);
+    if (this.ui) {
+      const { element } = this.ui;
+      element.addEventListener("mousedown", this.mouseDownListener);
+      element.addEventListener("touchstart", this.touchStartListener);
+      element.addEventListener("mouseup", this.mouseUpTouchEndListener);
+      element.addEventListener("touchend", this.mouseUpTouchEndListener);
+      element.addEventListener("keydown", this.keyListener);
+      element.addEventListener("keyup", this.keyListener);
+      element.addEventListener("mouseleave", this.mouseLeaveListener);
+    }
   }
 
   updateTranslations() {
-    this.element.ariaLabel = this.label();
+    if (this.ui) {
+      this.ui.element.ariaLabel = this.ui.label();
+    }
   }
 
   setValue(value: any) {
@@ -113,10 +120,12 @@ export class Button {
   }
 
   render() {
-    const fill = !!this.state.value ? "#00c800" : "#000000";
-    this.element.querySelectorAll("path.circle").forEach((c) => {
-      (c as SVGPathElement).style.fill = fill;
-    });
+    if (this.ui) {
+      const fill = !!this.state.value ? "#00c800" : "#000000";
+      this.ui.element.querySelectorAll("path.circle").forEach((c) => {
+        (c as SVGPathElement).style.fill = fill;
+      });
+    }
   }
 
   getAndClearPresses() {
@@ -0,0 +1,32 @@
+import { describe, expect, it } from "vitest";
+import { BytecodeCache, bytecodeCacheKey } from "./bytecode-cache";
+
+const encoder = new TextEncoder();
+
+describe("BytecodeCache", () => {
+  it("evicts the least recently used code when full", () => {
+    const cache = new BytecodeCache(10);
+    cache.set("a", new Uint8Array(4));
+    cache.set("b", new Uint8Array(4));
+    cache.get("a");
+    cache.set("c", new Uint8Array(4));
+    expect(cache.get("a")).toBeDefined();
+    expect(cache.get("b")).toBeUndefined();
+    expect(cache.get("c")).toBeDefined();
+  });
+
+  it("doesn't cache code bigger than the cache", () => {
+    const cache = new BytecodeCache(10);
+    cache.set("a", new Uint8Array(11));
+    expect(cache.get("a")).toBeUndefined();
+  });
+});
+
+describe("bytecodeCacheKey", () => {
+  it("depends on the name and content", () => {
+    const key = bytecodeCacheKey("a.py", encoder.encode("x = 1"));
+    expect(bytecodeCacheKey("a.py", encoder.encode("x = 1"))).toEqual(key);
+    expect(bytecodeCacheKey("b.py", encoder.encode("x = 1"))).not.toEqual(key);
+    expect(bytecodeCacheKey("a.py", encoder.encode("x = 2"))).not.toEqual(key);
+  });
+});
@@ -0,0 +1,75 @@
+/**
+ * Compiled MicroPython code for .py files so unchanged files aren't parsed
+ * and compiled again on every run. See bitsflow_fs_load_raw_code in
+ * bitsflowfs.c.
+ *
+ * Entries are keyed by the file name and a hash of its content, so they
+ * survive flashing the same files again and a file rewritten with new
+ * content misses. The compiled code is specific to the firmware build, so
+ * a cache must only be used with one firmware.
+ */
+
+// Plenty for a large multi-module project.
+const defaultMaxSize = 4 * 1024 * 1024;
+
+export class BytecodeCache {
+  // In insertion order, oldest first, for eviction.
+  private entries = new Map<string, Uint8Array>();
+  private size = 0;
+
+  constructor(private maxSize: number = defaultMaxSize) {}
+
+  get(key: string): Uint8Array | undefined {
+    const bytecode = this.entries.get(key);
+    if (bytecode) {
+      // Recently used so move it to the end.
+      this.entries.delete(key);
+      this.entries.set(key, bytecode);
+    }
+    return bytecode;
+  }
+
+  set(key: string, bytecode: Uint8Array) {
+    this.delete(key);
+    if (bytecode.length > this.maxSize) {
+      return;
+    }
+    this.entries.set(key, bytecode);
+    this.size += bytecode.length;
+    for (const [oldest] of this.entries) {
+      if (this.size <= this.maxSize) {
+        break;
+      }
+      this.delete(oldest);
+    }
+  }
+
+  private delete(key: string) {
+    const existing = this.entries.get(key);
+    if (existing) {
+      this.size -= existing.length;
+      this.entries.delete(key);
+    }
+  }
+}
+
+/**
+ * @returns a cache key for a file with the given name and content.
+ */
+export const bytecodeCacheKey = (name: string, data: Uint8Array): string => {
+  // cyrb53, a fast 53-bit hash. The length makes collisions even less
+  // likely.
+  let h1 = 0xdeadbeef;
+  let h2 = 0x41c6ce57;
+  for (let i = 0; i < data.length; ++i) {
+    const byte = data[i];
+    h1 = Math.imul(h1 ^ byte, 2654435761);
+    h2 = Math.imul(h2 ^ byte, 1597334677);
+  }
+  h1 = Math.imul(h1 ^ (h1 >>> 16), 2246822507);
+  h1 ^= Math.imul(h2 ^ (h2 >>> 13), 3266489909);
+  h2 = Math.imul(h2 ^ (h2 >>> 16), 2246822507);
+  h2 ^= Math.imul(h1 ^ (h1 >>> 13), 3266489909);
+  const hash = 4294967296 * (2097151 & h2) + (h1 >>> 0);
+  return `${name}:${data.length}:${hash.toString(36)}`;
+};
@@ -0,0 +1,108 @@
+import { afterEach, beforeEach, describe, expect, it, vi } from "vitest";
+import { PolledClock, skipForFirmware, VirtualClock } from "./clock";
+
+describe("VirtualClock", () => {
+  let clock = new VirtualClock();
+
+  beforeEach(() => {
+    vi.useFakeTimers();
+    clock = new VirtualClock();
+  });
+
+  afterEach(() => {
+    vi.useRealTimers();
+  });
+
+  it("runs at wall clock speed", () => {
+    vi.advanceTimersByTime(100);
+    expect(clock.now()).toEqual(100);
+  });
+
+  it("skips no further than the limit", () => {
+    expect(clock.skip(1000)).toEqual(true);
+    expect(clock.now()).toEqual(1000);
+  });
+
+  it("skips only to the next timeout", () => {
+    const callback = vi.fn();
+    clock.setTimeout(callback, 50);
+    expect(clock.skip(1000)).toEqual(true);
+    expect(clock.now()).toEqual(50);
+    expect(callback).not.toHaveBeenCalled();
+    vi.advanceTimersByTime(0);
+    expect(callback).toHaveBeenCalledTimes(1);
+  });
+
+  it("doesn't skip without a limit or timeout", () => {
+    expect(clock.skip(Number.POSITIVE_INFINITY)).toEqual(false);
+    expect(clock.now()).toEqual(0);
+  });
+
+  it("ignores cleared timeouts", () => {
+    const callback = vi.fn();
+    const timeout = clock.setTimeout(callback, 50);
+    clock.clearTimeout(timeout);
+    clock.skip(1000);
+    vi.advanceTimersByTime(0);
+    expect(callback).not.toHaveBeenCalled();
+    expect(clock.now()).toEqual(1000);
+  });
+
+  it("skips without a limit for the firmware's UINT32_MAX", () => {
+    clock.setTimeout(() => {}, 50);
+    // Either way it arrives from Wasm.
+    expect(skipForFirmware(clock, 0xffffffff)).toEqual(true);
+    expect(clock.now()).toEqual(50);
+    vi.advanceTimersByTime(0);
+    expect(skipForFirmware(clock, -1)).toEqual(false);
+    expect(clock.now()).toEqual(50);
+  });
+
+  it("skips up to the firmware's limit", () => {
+    expect(skipForFirmware(clock, 1000)).toEqual(true);
+    expect(clock.now()).toEqual(1000);
+  });
+
+  it("restarts from zero on reset", () => {
+    clock.skip(1000);
+    clock.reset();
+    expect(clock.now()).toEqual(0);
+  });
+});
+
+describe("PolledClock", () => {
+  let clock = new PolledClock();
+
+  beforeEach(() => {
+    vi.useFakeTimers();
+    clock = new PolledClock();
+  });
+
+  afterEach(() => {
+    vi.useRealTimers();
+  });
+
+  it("runs timeouts only when polled", () => {
+    const first = vi.fn();
+    const second = vi.fn();
+    clock.setTimeout(second, 20);
+    clock.setTimeout(first, 10);
+    expect(clock.msToNextTimeout()).toEqual(10);
+
+    vi.advanceTimersByTime(15);
+    expect(first).not.toHaveBeenCalled();
+    clock.runDueTimeouts();
+    expect(first).toHaveBeenCalledTimes(1);
+    expect(second).not.toHaveBeenCalled();
+    expect(clock.msToNextTimeout()).toEqual(5);
+  });
+
+  it("ignores cleared timeouts", () => {
+    const callback = vi.fn();
+    clock.clearTimeout(clock.setTimeout(callback, 10));
+    vi.advanceTimersByTime(10);
+    clock.runDueTimeouts();
+    expect(callback).not.toHaveBeenCalled();
+    expect(clock.msToNextTimeout()).toEqual(Number.POSITIVE_INFINITY);
+  });
+});
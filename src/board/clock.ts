@@ -0,0 +1,230 @@
+/**
+ * How long a busy program runs before yielding to JavaScript, in milliseconds.
+ *
+ * Each yield unwinds and rewinds the Wasm stack so yielding less often makes
+ * compute bound programs faster, at the cost of UI and input latency.
+ */
+export const defaultYieldBudgetMs = 8;
+
+/**
+ * The time source for the board and the timers that need to agree with it.
+ */
+export interface Clock {
+  /**
+   * If true, the firmware skips the clock ahead when idle rather than sleeping.
+   */
+  readonly virtual: boolean;
+
+  /**
+   * @returns milliseconds since the last reset.
+   */
+  now(): number;
+
+  reset(): void;
+
+  /**
+   * Skip ahead to the next timer but no further than maxMs.
+   *
+   * @returns true if there was something to skip to.
+   */
+  skip(maxMs: number): boolean;
+
+  setTimeout(callback: () => void, ms: number): any;
+
+  clearTimeout(timeout: any): void;
+}
+
+/**
+ * Skips the clock for the firmware, which passes the limit as a uint32
+ * (signed on the way out of Wasm) with UINT32_MAX for no limit.
+ *
+ * @returns true if there was something to skip to.
+ */
+export const skipForFirmware = (clock: Clock, maxMs: number): boolean => {
+  maxMs = maxMs >>> 0;
+  return clock.skip(maxMs === 0xffffffff ? Number.POSITIVE_INFINITY : maxMs);
+};
+
+export class WallClock implements Clock {
+  readonly virtual = false;
+
+  private epoch: number = new Date().getTime();
+
+  now() {
+    return new Date().getTime() - this.epoch;
+  }
+
+  reset() {
+    this.epoch = new Date().getTime();
+  }
+
+  skip(maxMs: number) {
+    return false;
+  }
+
+  setTimeout(callback: () => void, ms: number): any {
+    return setTimeout(callback, ms);
+  }
+
+  clearTimeout(timeout: any) {
+    clearTimeout(timeout);
+  }
+}
+
+interface QueuedTimeout {
+  time: number;
+  callback: () => void;
+}
+
+/**
+ * Timeouts sorted by time, with ties in insertion order.
+ */
+class TimeoutQueue {
+  private timeouts: QueuedTimeout[] = [];
+
+  get next(): number {
+    return this.timeouts[0]?.time ?? Number.POSITIVE_INFINITY;
+  }
+
+  add(callback: () => void, time: number): QueuedTimeout {
+    const timeout = { time, callback };
+    const index = this.timeouts.findIndex((t) => t.time > time);
+    if (index === -1) {
+      this.timeouts.push(timeout);
+    } else {
+      this.timeouts.splice(index, 0, timeout);
+    }
+    return timeout;
+  }
+
+  /**
+   * @returns true if the timeout was queued.
+   */
+  remove(timeout: QueuedTimeout): boolean {
+    const index = this.timeouts.indexOf(timeout);
+    if (index === -1) {
+      return false;
+    }
+    this.timeouts.splice(index, 1);
+    return true;
+  }
+
+  runDue(now: number) {
+    while (this.timeouts.length > 0 && this.timeouts[0].time <= now) {
+      this.timeouts.shift()!.callback();
+    }
+  }
+}
+
+/**
+ * A clock that runs at wall clock speed while the program is busy but skips
+ * ahead to the next deadline when it's idle.
+ *
+ * Sleeps, scrolling text and music complete as quickly as the program can
+ * run while time as measured by the program is unchanged.
+ */
+export class VirtualClock implements Clock {
+  readonly virtual = true;
+
+  private epoch: number = new Date().getTime();
+  private skipped: number = 0;
+  private timeouts = new TimeoutQueue();
+  private wallTimeout: any;
+
+  now() {
+    return new Date().getTime() - this.epoch + this.skipped;
+  }
+
+  reset() {
+    this.epoch = new Date().getTime();
+    this.skipped = 0;
+    this.armWallTimeout();
+  }
+
+  skip(maxMs: number) {
+    const now = this.now();
+    const target = Math.min(now + maxMs, this.timeouts.next);
+    if (target === Number.POSITIVE_INFINITY) {
+      return false;
+    }
+    if (target > now) {
+      this.skipped += target - now;
+      // Timeouts due now run when the firmware yields.
+      this.armWallTimeout();
+    }
+    return true;
+  }
+
+  setTimeout(callback: () => void, ms: number): any {
+    const timeout = this.timeouts.add(callback, this.now() + ms);
+    this.armWallTimeout();
+    return timeout;
+  }
+
+  clearTimeout(timeout: any) {
+    if (this.timeouts.remove(timeout)) {
+      this.armWallTimeout();
+    }
+  }
+
+  private armWallTimeout() {
+    clearTimeout(this.wallTimeout);
+    this.wallTimeout = undefined;
+    const next = this.timeouts.next;
+    if (next !== Number.POSITIVE_INFINITY) {
+      const delay = Math.max(0, next - this.now());
+      this.wallTimeout = setTimeout(() => this.runDueTimeouts(), delay);
+    }
+  }
+
+  private runDueTimeouts() {
+    this.timeouts.runDue(this.now());
+    this.armWallTimeout();
+  }
+}
+
+/**
+ * A wall clock whose timeouts are run by the board rather than the event
+ * loop.
+ *
+ * The blocking firmware doesn't return to the event loop while it runs so
+ * it calls the board to run the timeouts when it would otherwise yield.
+ */
+export class PolledClock implements Clock {
+  readonly virtual = false;
+
+  private epoch: number = new Date().getTime();
+  private timeouts = new TimeoutQueue();
+
+  now() {
+    return new Date().getTime() - this.epoch;
+  }
+
+  reset() {
+    this.epoch = new Date().getTime();
+  }
+
+  skip(maxMs: number) {
+    return false;
+  }
+
+  setTimeout(callback: () => void, ms: number): any {
+    return this.timeouts.add(callback, this.now() + ms);
+  }
+
+  clearTimeout(timeout: any) {
+    this.timeouts.remove(timeout);
+  }
+
+  /**
+   * @returns the time until the next timeout is due, or
+   * Number.POSITIVE_INFINITY if there are none.
+   */
+  msToNextTimeout(): number {
+    return Math.max(0, this.timeouts.next - this.now());
+  }
+
+  runDueTimeouts() {
+    this.timeouts.runDue(this.now());
+  }
+}
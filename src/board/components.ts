@@ -0,0 +1,161 @@
+import { Accelerometer } from "./accelerometer";
+import { Button } from "./buttons";
+import { Compass } from "./compass";
+import {
+  BITSFLOW_HAL_PIN_FACE,
+  BITSFLOW_HAL_PIN_P0,
+  BITSFLOW_HAL_PIN_P1,
+  BITSFLOW_HAL_PIN_P10,
+  BITSFLOW_HAL_PIN_P11,
+  BITSFLOW_HAL_PIN_P12,
+  BITSFLOW_HAL_PIN_P13,
+  BITSFLOW_HAL_PIN_P14,
+  BITSFLOW_HAL_PIN_P15,
+  BITSFLOW_HAL_PIN_P16,
+  BITSFLOW_HAL_PIN_P19,
+  BITSFLOW_HAL_PIN_P2,
+  BITSFLOW_HAL_PIN_P20,
+  BITSFLOW_HAL_PIN_P3,
+  BITSFLOW_HAL_PIN_P4,
+  BITSFLOW_HAL_PIN_P5,
+  BITSFLOW_HAL_PIN_P6,
+  BITSFLOW_HAL_PIN_P7,
+  BITSFLOW_HAL_PIN_P8,
+  BITSFLOW_HAL_PIN_P9,
+} from "./constants";
+import { DataLogging } from "./data-logging";
+import { Display } from "./display";
+import { Microphone } from "./microphone";
+import { Pin, StubPin, TouchPin } from "./pins";
+import { Radio } from "./radio";
+import { RangeSensor, State } from "./state";
+
+/**
+ * The components shared by the browser board and the headless board.
+ */
+export interface BoardComponents {
+  display: Display;
+  buttons: Button[];
+  pins: Pin[];
+  temperature: RangeSensor;
+  microphone: Microphone;
+  accelerometer: Accelerometer;
+  compass: Compass;
+  radio: Radio;
+  dataLogging: DataLogging;
+}
+
+/**
+ * Creates the pins indexed by their HAL ids.
+ *
+ * @param logo The UI for the touch logo or null when there's no UI.
+ */
+export function createPins(
+  logo: { element: SVGElement; label: () => string } | null,
+  onChange: (changes: Partial<State>) => void
+): Pin[] {
+  const pins: Pin[] = Array(33);
+  pins[BITSFLOW_HAL_PIN_FACE] = new TouchPin("pinLogo", logo, onChange);
+  pins[BITSFLOW_HAL_PIN_P0] = new TouchPin("pin0", null, onChange);
+  pins[BITSFLOW_HAL_PIN_P1] = new TouchPin("pin1", null, onChange);
+  pins[BITSFLOW_HAL_PIN_P2] = new TouchPin("pin2", null, onChange);
+  pins[BITSFLOW_HAL_PIN_P3] = new StubPin("pin3");
+  pins[BITSFLOW_HAL_PIN_P4] = new StubPin("pin4");
+  pins[BITSFLOW_HAL_PIN_P5] = new StubPin("pin5");
+  pins[BITSFLOW_HAL_PIN_P6] = new StubPin("pin6");
+  pins[BITSFLOW_HAL_PIN_P7] = new StubPin("pin7");
+  pins[BITSFLOW_HAL_PIN_P8] = new StubPin("pin8");
+  pins[BITSFLOW_HAL_PIN_P9] = new StubPin("pin9");
+  pins[BITSFLOW_HAL_PIN_P10] = new StubPin("pin10");
+  pins[BITSFLOW_HAL_PIN_P11] = new StubPin("pin11");
+  pins[BITSFLOW_HAL_PIN_P12] = new StubPin("pin12");
+  pins[BITSFLOW_HAL_PIN_P13] = new StubPin("pin13");
+  pins[BITSFLOW_HAL_PIN_P14] = new StubPin("pin14");
+  pins[BITSFLOW_HAL_PIN_P15] = new StubPin("pin15");
+  pins[BITSFLOW_HAL_PIN_P16] = new StubPin("pin16");
+  pins[BITSFLOW_HAL_PIN_P19] = new StubPin("pin19");
+  pins[BITSFLOW_HAL_PIN_P20] = new StubPin("pin20");
+  return pins;
+}
+
+export function getBoardState(board: BoardComponents): State {
+  return {
+    radio: board.radio.state,
+    buttonA: board.buttons[0].state,
+    buttonB: board.buttons[1].state,
+    pinLogo: board.pins[BITSFLOW_HAL_PIN_FACE].state,
+    pin0: board.pins[BITSFLOW_HAL_PIN_P0].state,
+    pin1: board.pins[BITSFLOW_HAL_PIN_P1].state,
+    pin2: board.pins[BITSFLOW_HAL_PIN_P2].state,
+
+    accelerometerX: board.accelerometer.state.accelerometerX,
+    accelerometerY: board.accelerometer.state.accelerometerY,
+    accelerometerZ: board.accelerometer.state.accelerometerZ,
+    gesture: board.accelerometer.state.gesture,
+
+    compassX: board.compass.state.compassX,
+    compassY: board.compass.state.compassY,
+    compassZ: board.compass.state.compassZ,
+    compassHeading: board.compass.state.compassHeading,
+
+    lightLevel: board.display.lightLevel,
+    dataLogging: board.dataLogging.state,
+    soundLevel: board.microphone.soundLevel,
+    temperature: board.temperature,
+  };
+}
+
+export function setBoardValue(board: BoardComponents, id: string, value: any) {
+  switch (id) {
+    case "accelerometerX":
+    case "accelerometerY":
+    case "accelerometerZ":
+    case "gesture": {
+      board.accelerometer.setValue(id, value);
+      break;
+    }
+    case "compassX":
+    case "compassY":
+    case "compassZ":
+    case "compassHeading": {
+      board.compass.setValue(id, value);
+      break;
+    }
+    case "buttonA": {
+      board.buttons[0].setValue(value);
+      break;
+    }
+    case "buttonB": {
+      board.buttons[1].setValue(value);
+      break;
+    }
+    case "pinLogo": {
+      board.pins[BITSFLOW_HAL_PIN_FACE].setValue(value);
+      break;
+    }
+    case "pin0": {
+      board.pins[BITSFLOW_HAL_PIN_P0].setValue(value);
+      break;
+    }
+    case "pin1": {
+      board.pins[BITSFLOW_HAL_PIN_P1].setValue(value);
+      break;
+    }
+    case "pin2": {
+      board.pins[BITSFLOW_HAL_PIN_P2].setValue(value);
+      break;
+    }
+    case "lightLevel": {
+      board.display.lightLevel.setValue(value);
+      break;
+    }
+    case "soundLevel": {
+      board.microphone.setValue(value);
+      break;
+    }
+    case "temperature": {
+      board.temperature.setValue(value);
+      break;
+    }
+  }
+}
@@ -67,3 +67,6 @@ export const BITSFLOW_HAL_LOG_TIMESTAMP_SECONDS = 10;
 export const BITSFLOW_HAL_LOG_TIMESTAMP_MINUTES = 600;
 export const BITSFLOW_HAL_LOG_TIMESTAMP_HOURS = 36000;
 export const BITSFLOW_HAL_LOG_TIMESTAMP_DAYS = 864000;
+
+export const BITSFLOW_HAL_LOG_VALUE_INT = 0;
+export const BITSFLOW_HAL_LOG_VALUE_STR = 1;
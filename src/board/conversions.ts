@@ -95,10 +95,12 @@ export function convertAccelerometerNumberToString(value: number): string {
   }
 }
 
-export const convertAudioBuffer = (
+export const convertAudioBuffer = <
+  T extends Pick<AudioBuffer, "getChannelData">
+>(
   heap: Uint8Array,
   source: number,
-  target: AudioBuffer
+  target: T
 ) => {
   const channel = target.getChannelData(0);
   for (let i = 0; i < channel.length; ++i) {
@@ -0,0 +1,38 @@
+import { describe, expect, it } from "vitest";
+import { DataLogStore } from "./data-log-store";
+
+describe("DataLogStore", () => {
+  it("exports CSV with columns added part way through", () => {
+    const store = new DataLogStore();
+    store.add({ headings: ["a"], data: ["1"] });
+    store.add({ data: ["2"] });
+    store.add({ headings: ["a", "b"], data: ["3", "4"] });
+    expect(store.length).toEqual(3);
+    expect(Array.from(store.csv()).join("")).toEqual(
+      "a,b\r\n1,\r\n2,\r\n3,4\r\n"
+    );
+  });
+
+  it("exports in chunks", () => {
+    const store = new DataLogStore();
+    store.add({ headings: ["x"] });
+    for (let i = 0; i < 100; ++i) {
+      store.add({ data: [i.toString()] });
+    }
+    const chunks = Array.from(store.csv(64));
+    expect(chunks.length).toBeGreaterThan(1);
+    expect(chunks.join("").split("\r\n").slice(0, 3)).toEqual([
+      "x",
+      "0",
+      "1",
+    ]);
+  });
+
+  it("clears", () => {
+    const store = new DataLogStore();
+    store.add({ headings: ["a"], data: ["1"] });
+    store.clear();
+    expect(store.length).toEqual(0);
+    expect(Array.from(store.csv())).toEqual([]);
+  });
+});
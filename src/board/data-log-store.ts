@@ -0,0 +1,70 @@
+import { LogEntry } from ".";
+
+/**
+ * The data log as the embedder sees it, kept so it can be exported as CSV
+ * without replaying log_output messages.
+ *
+ * Values are stored by column and only ever appended. Headings are only
+ * appended too, so rows logged before a column existed are empty in it.
+ */
+export class DataLogStore {
+  private headings: string[] = [];
+  private columns: string[][] = [];
+  // The row each column was added at.
+  private columnStarts: number[] = [];
+  private rowCount = 0;
+
+  get length(): number {
+    return this.rowCount;
+  }
+
+  add(entry: LogEntry) {
+    if (entry.headings) {
+      for (let i = this.headings.length; i < entry.headings.length; ++i) {
+        this.headings.push(entry.headings[i]);
+        this.columns.push([]);
+        this.columnStarts.push(this.rowCount);
+      }
+    }
+    if (entry.data) {
+      const { data } = entry;
+      for (let i = 0; i < this.columns.length; ++i) {
+        this.columns[i].push(data[i] ?? "");
+      }
+      this.rowCount++;
+    }
+  }
+
+  clear() {
+    this.headings = [];
+    this.columns = [];
+    this.columnStarts = [];
+    this.rowCount = 0;
+  }
+
+  /**
+   * Generates the log as CSV, in chunks of about maxChunkLength so a large
+   * log needn't be built as one string.
+   */
+  *csv(maxChunkLength: number = 64 * 1024): Generator<string> {
+    if (this.headings.length === 0) {
+      return;
+    }
+    let chunk = this.headings.join(",") + "\r\n";
+    const row: string[] = new Array(this.columns.length);
+    for (let r = 0; r < this.rowCount; ++r) {
+      for (let c = 0; c < this.columns.length; ++c) {
+        const start = this.columnStarts[c];
+        row[c] = r < start ? "" : this.columns[c][r - start];
+      }
+      chunk += row.join(",") + "\r\n";
+      if (chunk.length >= maxChunkLength) {
+        yield chunk;
+        chunk = "";
+      }
+    }
+    if (chunk) {
+      yield chunk;
+    }
+  }
+}
@@ -15,6 +15,9 @@ import { DataLoggingState, State } from "./state";
 // This is only approximate as we don't serialize our state in the same way but
 // it's important for the user to see that the log can fill up.
 const maxSizeBytes = 118780;
+// Lines are sized as a comma after each value plus a newline, approximating
+// the CSV in the flash.
+const emptyLineSize = 1;
 
 export class DataLogging {
   private mirroring: boolean = false;
@@ -23,8 +26,18 @@ export class DataLogging {
   private timestampOnLastEndRow: number | undefined;
   private headingsChanged: boolean = false;
   private headings: string[] = [];
+  private headingIndexes = new Map<string, number>();
   private row: string[] | undefined;
+  // The sizes of the headings and row as CSV lines, kept up to date as they
+  // change so rows cost the same however many columns there are.
+  private headingsSize: number = emptyLineSize;
+  private rowSize: number = emptyLineSize;
   state: DataLoggingState = { type: "dataLogging", logFull: false };
+  /**
+   * Keys by qstr, so rows added by log.add needn't decode them from the
+   * firmware's memory each time. Only valid while the program runs.
+   */
+  qstrKeys = new Map<number, string>();
 
   constructor(
     private currentTimeMillis: () => number,
@@ -45,6 +58,7 @@ export class DataLogging {
   beginRow() {
     this.row = new Array(this.headings.length);
     this.row.fill("");
+    this.rowSize = emptyLineSize + this.row.length;
     return BITSFLOW_HAL_DEVICE_OK;
   }
 
@@ -58,8 +72,10 @@ export class DataLogging {
     ) {
       // New timestamp column required. Put it first if there's been no output.
       if (this.size === 0) {
-        this.headings = [timestampToHeading(this.timestamp), ...this.headings];
+        const heading = timestampToHeading(this.timestamp);
+        this.setHeadings([heading, ...this.headings]);
         this.row = ["", ...this.row];
+        this.rowSize += 1;
       } else {
         this.logData(timestampToHeading(this.timestamp), "");
       }
@@ -82,7 +98,9 @@ export class DataLogging {
     }
 
     if (entry.data || entry.headings) {
-      const entrySize = calculateEntrySize(entry);
+      const entrySize =
+        (entry.headings ? this.headingsSize : 0) +
+        (entry.data ? this.rowSize : 0);
       if (this.size + entrySize > maxSizeBytes) {
         if (!this.state.logFull) {
           this.state = {
@@ -107,12 +125,16 @@ export class DataLogging {
     if (!this.row) {
       throw noRowError();
     }
-    const index = this.headings.indexOf(key);
-    if (index === -1) {
+    const index = this.headingIndexes.get(key);
+    if (index === undefined) {
+      this.headingIndexes.set(key, this.headings.length);
       this.headings.push(key);
+      this.headingsSize += key.length + 1;
       this.row.push(value);
+      this.rowSize += value.length + 1;
       this.headingsChanged = true;
     } else {
+      this.rowSize += value.length - this.row[index].length;
       this.row[index] = value;
     }
 
@@ -136,6 +158,7 @@ export class DataLogging {
   boardStopped() {
     // We don't delete the log here as it's on flash, but we do reset in-memory state.
     this.resetNonFlashStateExceptTimestamp();
+    this.qstrKeys.clear();
     // Keep the timestamp if we could restore it from a persisted log.
     if (this.size === 0) {
       this.timestamp = BITSFLOW_HAL_LOG_TIMESTAMP_NONE;
@@ -144,7 +167,7 @@ export class DataLogging {
 
   delete() {
     this.resetNonFlashStateExceptTimestamp();
-    this.headings = [];
+    this.setHeadings([]);
     this.timestampOnLastEndRow = undefined;
 
     this.size = 0;
@@ -161,6 +184,15 @@ export class DataLogging {
     this.onLogDelete();
   }
 
+  private setHeadings(headings: string[]) {
+    this.headings = headings;
+    this.headingIndexes = new Map(headings.map((heading, i) => [heading, i]));
+    this.headingsSize = headings.reduce(
+      (size, heading) => size + heading.length + 1,
+      emptyLineSize
+    );
+  }
+
   private resetNonFlashStateExceptTimestamp() {
     // headings are considered flash state as MicroBitLog reparses them from flash
     this.mirroring = false;
@@ -173,17 +205,6 @@ function noRowError() {
   return new Error("HAL clients should always start a row");
 }
 
-function calculateEntrySize(entry: LogEntry): number {
-  // +1s for commas and a newline, approximating the CSV in the flash.
-  const headings = entry.headings
-    ? entry.headings.reduce((prev, curr) => prev + curr.length + 1, 0) + 1
-    : 0;
-  const data = entry.data
-    ? entry.data.reduce((prev, curr) => prev + curr.length + 1, 0) + 1
-    : 0;
-  return headings + data;
-}
-
 function timestampToHeading(timestamp: number): string {
   return `Time (${timestampToUnitString(timestamp)})`;
 }
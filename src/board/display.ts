@@ -15,7 +15,10 @@ export class Display {
     undefined
   );
   private state: Array<Array<number>>;
-  constructor(private leds: SVGElement[]) {
+  // The brightness last written to each LED's style, indexed by y * 5 + x.
+  private rendered: number[] = Array(25).fill(-1);
+  private renderPending: boolean = false;
+  constructor(private leds: SVGElement[] | null) {
     this.leds = leds;
     this.state = this.initialState();
   }
@@ -31,7 +34,7 @@ export class Display {
   }
 
   /**
-   * This is only used for panic. HAL interactions are via setPixel.
+   * This is only used for panic. HAL interactions are via setFrame and setPixel.
    */
   show(image: Array<Array<number>>) {
     for (let y = 0; y < 5; ++y) {
@@ -39,29 +42,64 @@ export class Display {
         this.state[x][y] = clamp(image[y][x], 0, 9);
       }
     }
-    this.render();
+    this.scheduleRender();
   }
 
   clear() {
     this.state = this.initialState();
-    this.render();
+    this.scheduleRender();
+  }
+
+  /**
+   * @param frame 25 brightness values in row-major order.
+   */
+  setFrame(frame: Uint8Array) {
+    for (let y = 0; y < 5; ++y) {
+      for (let x = 0; x < 5; ++x) {
+        this.state[x][y] = clamp(frame[y * 5 + x], 0, 9);
+      }
+    }
+    this.scheduleRender();
   }
 
   setPixel(x: number, y: number, value: number) {
     value = clamp(value, 0, 9);
     this.state[x][y] = value;
-    this.render();
+    this.scheduleRender();
   }
 
   getPixel(x: number, y: number) {
     return this.state[x][y];
   }
 
+  /**
+   * Render at most once per animation frame however many changes there are.
+   */
+  protected scheduleRender() {
+    if (!this.leds || this.renderPending) {
+      return;
+    }
+    this.renderPending = true;
+    requestAnimationFrame(() => {
+      this.renderPending = false;
+      this.render();
+    });
+  }
+
   render() {
+    if (!this.leds) {
+      return;
+    }
     for (let x = 0; x < 5; ++x) {
       for (let y = 0; y < 5; ++y) {
+        const index = y * 5 + x;
         const on = this.state[x][y];
-        const led = this.leds[y * 5 + x];
+        // Only touch the styles of LEDs that have changed.
+        if (this.rendered[index] === on) {
+          continue;
+        }
+        this.rendered[index] = on;
+        const led = this.leds[index];
         if (on) {
           const bright = brightMap[this.state[x][y]];
           led.style.display = "inline";
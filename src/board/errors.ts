@@ -0,0 +1,11 @@
+export class PanicError extends Error {
+  constructor(public code: number) {
+    super("panic");
+  }
+}
+
+export class ResetError extends Error {
+  constructor() {
+    super("reset");
+  }
+}
@@ -0,0 +1,110 @@
+import { describe, expect, it } from "vitest";
+import { FileSystem } from "./fs";
+
+const encoder = new TextEncoder();
+const decoder = new TextDecoder();
+
+const readAll = (fs: FileSystem, idx: number) => {
+  const target = new Uint8Array(fs.size(idx));
+  fs.read(idx, 0, target);
+  return decoder.decode(target);
+};
+
+describe("FileSystem", () => {
+  it("appends across many writes", () => {
+    const fs = new FileSystem();
+    const idx = fs.create("data.csv");
+    let expected = "";
+    for (let i = 0; i < 500; ++i) {
+      const row = `${i},${i * i}\n`;
+      expected += row;
+      expect(fs.write(idx, encoder.encode(row))).toEqual(true);
+    }
+    expect(fs.size(idx)).toEqual(expected.length);
+    expect(readAll(fs, idx)).toEqual(expected);
+  });
+
+  it("reads from an offset up to the end of the file", () => {
+    const fs = new FileSystem();
+    const idx = fs.create("main.py");
+    fs.write(idx, encoder.encode("hello"));
+    const target = new Uint8Array(10);
+    expect(fs.read(idx, 2, target)).toEqual(3);
+    expect(decoder.decode(target.subarray(0, 3))).toEqual("llo");
+    expect(fs.read(idx, 5, target)).toEqual(0);
+    expect(fs.read(idx + 1, 0, target)).toEqual(-1);
+  });
+
+  it("finds, truncates and reuses files by name", () => {
+    const fs = new FileSystem();
+    const a = fs.create("a.py");
+    const b = fs.create("b.py");
+    expect(fs.find("a.py")).toEqual(a);
+    expect(fs.find("b.py")).toEqual(b);
+    expect(fs.find("c.py")).toEqual(-1);
+
+    fs.write(a, encoder.encode("abc"));
+    expect(fs.create("a.py")).toEqual(a);
+    expect(fs.size(a)).toEqual(0);
+
+    fs.remove(a);
+    expect(fs.find("a.py")).toEqual(-1);
+    expect(fs.name(a)).toBeUndefined();
+    expect(fs.create("c.py")).toEqual(a);
+  });
+
+  it("limits the total size and releases space on truncate", () => {
+    const fs = new FileSystem();
+    const idx = fs.create("big.bin");
+    const chunk = new Uint8Array(1024);
+    for (let i = 0; i < 31; ++i) {
+      expect(fs.write(idx, chunk)).toEqual(true);
+    }
+    expect(fs.write(idx, chunk)).toEqual(false);
+    fs.create("big.bin");
+    expect(fs.write(idx, chunk)).toEqual(true);
+  });
+
+  it("caches compiled code for the current content", () => {
+    const fs = new FileSystem();
+    const bytecode = new Uint8Array([77, 6]);
+    const idx = fs.create("main.py");
+    fs.write(idx, encoder.encode("print(1)"));
+    expect(fs.bytecode(idx)).toBeUndefined();
+    fs.setBytecode(idx, bytecode);
+    expect(fs.bytecode(idx)).toEqual(bytecode);
+
+    // Changed by a write.
+    fs.write(idx, encoder.encode("\nprint(2)"));
+    expect(fs.bytecode(idx)).toBeUndefined();
+
+    // Kept across flashing the same content again.
+    fs.clear();
+    const again = fs.create("main.py");
+    fs.write(again, encoder.encode("print(1)"));
+    expect(fs.bytecode(again)).toEqual(bytecode);
+
+    // But not for another file.
+    const other = fs.create("other.py");
+    fs.write(other, encoder.encode("print(1)"));
+    expect(fs.bytecode(other)).toBeUndefined();
+  });
+
+  it("saves and reads compiled code in pieces", () => {
+    const fs = new FileSystem();
+    const idx = fs.create("a.py");
+    const target = new Uint8Array(2);
+    expect(fs.readBytecode(idx, 0, target)).toEqual(-1);
+    // An abandoned save is discarded when the next starts.
+    fs.writeBytecode(0, new Uint8Array([9]));
+    fs.writeBytecode(0, new Uint8Array([1, 2]));
+    fs.writeBytecode(2, new Uint8Array([3]));
+    fs.endBytecode(idx);
+    expect(fs.bytecode(idx)).toEqual(new Uint8Array([1, 2, 3]));
+    expect(fs.readBytecode(idx, 0, target)).toEqual(2);
+    expect(Array.from(target)).toEqual([1, 2]);
+    expect(fs.readBytecode(idx, 2, target)).toEqual(1);
+    expect(target[0]).toEqual(3);
+    expect(fs.readBytecode(idx, 3, target)).toEqual(0);
+  });
+});
@@ -1,42 +1,48 @@
+import { BytecodeCache, bytecodeCacheKey } from "./bytecode-cache";
+
 // Size as per C implementation.
 const maxSize = 31.5 * 1024;
 
 export class FileSystem {
   // Each entry is an FsFile object. The indexes are used as identifiers.
-  // When a file is deleted the entry becomes ['', null] and can be reused.
+  // When a file is deleted the entry becomes null and can be reused.
   private _content: Array<FsFile | null> = [];
+  private _index = new Map<string, number>();
+  private _free: number[] = [];
   private _size = 0;
+  // See writeBytecode.
+  private _pendingBytecode: Uint8Array[] = [];
+
+  /**
+   * @param bytecodeCache Kept when the file system is cleared. Can be
+   * shared between file systems used with the same firmware.
+   */
+  constructor(readonly bytecodeCache: BytecodeCache = new BytecodeCache()) {}
 
   create(name: string) {
-    let free_idx = -1;
-    for (let idx = 0; idx < this._content.length; ++idx) {
-      const entry = this._content[idx];
-      if (entry === null) {
-        free_idx = idx;
-      } else if (entry.name === name) {
-        // Truncate existing file and return it.
-        entry.truncate();
-        return idx;
-      }
+    const existing = this._index.get(name);
+    if (existing !== undefined) {
+      // Truncate existing file and return it.
+      const entry = this._content[existing]!;
+      this._size -= entry.size();
+      entry.truncate();
+      return existing;
     }
-    if (free_idx < 0) {
-      // Add a new file and return it.
+    let idx = this._free.pop();
+    if (idx === undefined) {
+      // Add a new file.
+      idx = this._content.length;
       this._content.push(new FsFile(name));
-      return this._content.length - 1;
     } else {
       // Reuse existing slot for the new file.
-      this._content[free_idx] = new FsFile(name);
-      return free_idx;
+      this._content[idx] = new FsFile(name);
     }
+    this._index.set(name, idx);
+    return idx;
   }
 
   find(name: string) {
-    for (let idx = 0; idx < this._content.length; ++idx) {
-      if (this._content[idx]?.name === name) {
-        return idx;
-      }
-    }
-    return -1;
+    return this._index.get(name) ?? -1;
   }
 
   name(idx: number) {
@@ -57,12 +63,20 @@ export class FileSystem {
     if (file) {
       this._size -= file.size();
       this._content[idx] = null;
+      this._index.delete(file.name);
+      this._free.push(idx);
     }
   }
 
-  readbyte(idx: number, offset: number) {
+  /**
+   * Copies file data from offset into target.
+   *
+   * @returns the number of bytes read, 0 at the end of the file or -1 if
+   * there's no such file.
+   */
+  read(idx: number, offset: number, target: Uint8Array): number {
     const file = this._content[idx];
-    return file ? file.readbyte(offset) : -1;
+    return file ? file.read(offset, target) : -1;
   }
 
   write(idx: number, data: Uint8Array, force: boolean = false): boolean {
@@ -78,10 +92,68 @@ export class FileSystem {
     return true;
   }
 
-  clear() {
-    for (let idx = 0; idx < this._content.length; ++idx) {
-      this.remove(idx);
+  /**
+   * @returns the compiled code for the file's current content, if cached.
+   */
+  bytecode(idx: number): Uint8Array | undefined {
+    const file = this._content[idx];
+    return file ? this.bytecodeCache.get(file.bytecodeCacheKey()) : undefined;
+  }
+
+  setBytecode(idx: number, bytecode: Uint8Array) {
+    const file = this._content[idx];
+    if (file) {
+      this.bytecodeCache.set(file.bytecodeCacheKey(), bytecode);
+    }
+  }
+
+  /**
+   * Reads the file's cached compiled code in pieces, like read.
+   *
+   * @returns the number of bytes read, or -1 if it's not cached.
+   */
+  readBytecode(idx: number, offset: number, target: Uint8Array): number {
+    const bytecode = this.bytecode(idx);
+    if (!bytecode) {
+      return -1;
+    }
+    const data = bytecode.subarray(offset, offset + target.length);
+    target.set(data);
+    return data.length;
+  }
+
+  /**
+   * Saves compiled code in pieces, as the firmware writes it, so it needn't
+   * hold it all at once. Writing at offset zero starts afresh. Cached for the
+   * file by endBytecode.
+   */
+  writeBytecode(offset: number, data: Uint8Array) {
+    if (offset === 0) {
+      this._pendingBytecode = [];
     }
+    this._pendingBytecode.push(data);
+  }
+
+  endBytecode(idx: number) {
+    const length = this._pendingBytecode.reduce(
+      (total, data) => total + data.length,
+      0
+    );
+    const bytecode = new Uint8Array(length);
+    let offset = 0;
+    for (const data of this._pendingBytecode) {
+      bytecode.set(data, offset);
+      offset += data.length;
+    }
+    this._pendingBytecode = [];
+    this.setBytecode(idx, bytecode);
+  }
+
+  clear() {
+    this._content = [];
+    this._index.clear();
+    this._free = [];
+    this._size = 0;
   }
 
   toString() {
@@ -90,25 +162,51 @@ export class FileSystem {
 }
 
 const EMPTY_ARRAY = new Uint8Array(0);
+const MIN_CAPACITY = 64;
 
 class FsFile {
-  constructor(public name: string, private buffer: Uint8Array = EMPTY_ARRAY) {}
-  readbyte(offset: number) {
-    if (offset < this.buffer.length) {
-      return this.buffer[offset];
-    }
-    return -1;
+  // The file data is the first _length bytes of _buffer.
+  // Capacity doubles as needed so appending is amortised O(1).
+  private _buffer: Uint8Array = EMPTY_ARRAY;
+  private _length = 0;
+  // Computed on demand and reset when the content changes.
+  private _bytecodeCacheKey: string | undefined;
+
+  constructor(public name: string) {}
+  read(offset: number, target: Uint8Array) {
+    const end = Math.min(offset + target.length, this._length);
+    const data = this._buffer.subarray(offset, Math.max(offset, end));
+    target.set(data);
+    return data.length;
   }
   append(data: Uint8Array) {
-    const updated = new Uint8Array(this.buffer.length + data.length);
-    updated.set(this.buffer);
-    updated.set(data, this.buffer.length);
-    this.buffer = updated;
+    const length = this._length + data.length;
+    if (length > this._buffer.length) {
+      const updated = new Uint8Array(
+        Math.max(length, this._buffer.length * 2, MIN_CAPACITY)
+      );
+      updated.set(this._buffer.subarray(0, this._length));
+      this._buffer = updated;
+    }
+    this._buffer.set(data, this._length);
+    this._length = length;
+    this._bytecodeCacheKey = undefined;
   }
   truncate() {
-    this.buffer = EMPTY_ARRAY;
+    this._buffer = EMPTY_ARRAY;
+    this._length = 0;
+    this._bytecodeCacheKey = undefined;
+  }
+  bytecodeCacheKey() {
+    if (this._bytecodeCacheKey === undefined) {
+      this._bytecodeCacheKey = bytecodeCacheKey(
+        this.name,
+        this._buffer.subarray(0, this._length)
+      );
+    }
+    return this._bytecodeCacheKey;
   }
   size() {
-    return this.buffer.length;
+    return this._length;
   }
 }
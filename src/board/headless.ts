@@ -0,0 +1,433 @@
+import type { LogEntry } from ".";
+import { Accelerometer } from "./accelerometer";
+import { HeadlessAudio } from "./audio/headless";
+import { Button } from "./buttons";
+import {
+  Clock,
+  defaultYieldBudgetMs,
+  skipForFirmware,
+  WallClock,
+} from "./clock";
+import { Compass } from "./compass";
+import {
+  BoardComponents,
+  createPins,
+  getBoardState,
+  setBoardValue,
+} from "./components";
+import * as conversions from "./conversions";
+import { DataLogging } from "./data-logging";
+import { Display } from "./display";
+import { PanicError, ResetError } from "./errors";
+import { FileSystem } from "./fs";
+import { Microphone } from "./microphone";
+import { Pin } from "./pins";
+import { Radio } from "./radio";
+import { SerialInputQueue } from "./serial-input";
+import { RangeSensor, State } from "./state";
+import { instantiateFirmware, Stats, StatsCollector } from "./stats";
+import {
+  defaultHeapSize,
+  EmscriptenModule,
+  GcStats,
+  ModuleWrapper,
+} from "./wasm";
+
+/**
+ * How long we wait for a timed out program to respond to Ctrl-C.
+ */
+const stopGracePeriodMs = 1000;
+
+export interface HeadlessNotifications {
+  onStateChange: (change: Partial<State>) => void;
+  onSerialOutput: (data: string) => void;
+  /**
+   * If defined, the firmware's serial output is passed here as UTF-8 rather
+   * than decoded for onSerialOutput. The data is a view of the firmware's
+   * memory so must be copied to keep it.
+   */
+  onSerialOutputBytes?: (data: Uint8Array) => void;
+  onRadioOutput: (data: Uint8Array) => void;
+  onLogOutput: (data: LogEntry) => void;
+  onLogDelete: () => void;
+}
+
+/**
+ * The firmware build output, loaded by the host environment.
+ */
+export interface Firmware {
+  /**
+   * The MODULARIZE factory exported by firmware.js.
+   */
+  createModule: (args: object) => Promise<EmscriptenModule>;
+  /**
+   * firmware.wasm, compiled once and instantiated per run.
+   */
+  wasm: WebAssembly.Module;
+  /**
+   * True for firmware-blocking, built without asyncify. It doesn't return to
+   * the event loop until it stops so it's only used by WorkerBoard.
+   */
+  blocking?: boolean;
+}
+
+export type HeadlessStopKind =
+  /**
+   * main.py finished or was stopped by the program.
+   */
+  | "default"
+  /**
+   * The program called panic.
+   */
+  | "panic"
+  /**
+   * The program requested a reset.
+   */
+  | "reset"
+  /**
+   * The program ran beyond the timeout and was interrupted.
+   */
+  | "timeout"
+  /**
+   * Something went wrong in the simulator itself.
+   */
+  | "error";
+
+export interface HeadlessResult {
+  kind: HeadlessStopKind;
+  /**
+   * Defined for "panic".
+   */
+  panicCode?: number;
+  /**
+   * Defined for "error".
+   */
+  error?: any;
+  /**
+   * May be undefined if the simulator failed.
+   */
+  gc?: GcStats;
+  durationMs: number;
+}
+
+/**
+ * A board with no UI that runs main.py once.
+ *
+ * Used to run programs from Node.js, e.g. for automated testing.
+ * Input is scripted via setValue, writeSerialInput and schedule.
+ * With a VirtualClock idle time is skipped so programs run faster than
+ * real time.
+ */
+export class HeadlessBoard implements BoardComponents {
+  display: Display;
+  buttons: Button[];
+  pins: Pin[];
+  audio: HeadlessAudio;
+  temperature: RangeSensor;
+  microphone: Microphone;
+  accelerometer: Accelerometer;
+  compass: Compass;
+  radio: Radio;
+  dataLogging: DataLogging;
+
+  public serialInput = new SerialInputQueue();
+
+  /**
+   * Read by the firmware when it starts.
+   */
+  yieldBudgetMs: number = defaultYieldBudgetMs;
+  /**
+   * The MicroPython heap size in bytes, used when the program starts.
+   */
+  heapSize: number = defaultHeapSize;
+
+  /**
+   * Defined while running.
+   */
+  protected module: ModuleWrapper | undefined;
+  /**
+   * Set once we've interrupted a timed out program.
+   */
+  private interrupted: boolean = false;
+  private scheduled: { time: number; action: () => void }[] = [];
+  protected stats: StatsCollector | undefined;
+  protected lastGcStats: GcStats | undefined;
+  private scheduledTimeouts: any[] = [];
+  private decoder = new TextDecoder();
+
+  constructor(
+    private firmware: Firmware,
+    private fs: FileSystem,
+    private notifications: HeadlessNotifications,
+    public clock: Clock = new WallClock()
+  ) {
+    const onChange = this.notifications.onStateChange;
+    this.display = new Display(null);
+    this.buttons = [
+      new Button("buttonA", null, onChange),
+      new Button("buttonB", null, onChange),
+    ];
+    this.pins = createPins(null, onChange);
+    this.audio = new HeadlessAudio(this.clock);
+    this.temperature = new RangeSensor("temperature", -5, 50, 21, "°C");
+    this.accelerometer = new Accelerometer(onChange);
+    this.compass = new Compass();
+    this.microphone = new Microphone(null, onChange);
+
+    const currentTimeMillis = this.ticksMilliseconds.bind(this);
+    this.radio = new Radio(
+      this.notifications.onRadioOutput,
+      onChange,
+      currentTimeMillis
+    );
+    this.dataLogging = new DataLogging(
+      currentTimeMillis,
+      this.notifications.onLogOutput,
+      this.notifications.onSerialOutput,
+      this.notifications.onLogDelete,
+      onChange
+    );
+  }
+
+  protected async createModule(): Promise<ModuleWrapper> {
+    const wrapped = await this.firmware.createModule({
+      board: this,
+      fs: this.fs,
+      conversions,
+      noInitialRun: true,
+      instantiateWasm: (
+        imports: WebAssembly.Imports,
+        successCallback: (instance: WebAssembly.Instance) => void
+      ) => {
+        instantiateFirmware(this.firmware.wasm, imports, this.stats).then(
+          successCallback
+        );
+        return {};
+      },
+      // The default exits the Node.js process.
+      quit: (status: number, toThrow: Error) => {
+        throw toThrow;
+      },
+    });
+    return new ModuleWrapper(wrapped, this.firmware.blocking);
+  }
+
+  /**
+   * Connects the components that call into the firmware to the module.
+   * Needed for each run as stopping disposes the audio callbacks.
+   */
+  protected initializeCallbacks({ module }: ModuleWrapper) {
+    this.audio.initializeCallbacks({
+      defaultAudioCallback: module._bitsflow_hal_audio_ready_callback,
+      speechAudioCallback: module._bitsflow_hal_audio_speech_ready_callback,
+    });
+    this.accelerometer.initializeCallbacks(
+      module._bitsflow_hal_gesture_callback
+    );
+    this.microphone.initializeCallbacks(
+      module._bitsflow_hal_level_detector_callback
+    );
+  }
+
+  /**
+   * Starts or stops collecting stats on calls between the firmware and
+   * JavaScript. Takes effect when the firmware is next created, e.g. for
+   * the next run.
+   */
+  enableStats(enabled: boolean) {
+    if (!enabled) {
+      this.stats = undefined;
+    } else if (!this.stats) {
+      this.stats = new StatsCollector();
+    }
+  }
+
+  /**
+   * @returns the stats since they were enabled or last taken, or undefined
+   * if they're not enabled.
+   */
+  takeStats(): Stats | undefined {
+    return this.stats?.take();
+  }
+
+  /**
+   * @returns GC stats for the current run, or the last one.
+   */
+  gcStats(): GcStats | undefined {
+    return this.module?.gcStats() ?? this.lastGcStats;
+  }
+
+  /**
+   * Runs main.py from the file system once.
+   *
+   * @param timeoutMs Interrupt the program if it runs for longer than this.
+   * @returns a promise that resolves when the program has stopped.
+   */
+  async run(timeoutMs: number): Promise<HeadlessResult> {
+    if (this.module) {
+      throw new Error("Already running!");
+    }
+    const startTime = performance.now();
+    const module = await this.createModule();
+    this.initializeCallbacks(module);
+    this.module = module;
+    this.interrupted = false;
+    // Requesting a stop up front means we stop after main.py rather than
+    // entering the REPL.
+    module.requestStop();
+
+    let result: Omit<HeadlessResult, "durationMs">;
+    const running = module.start(this.heapSize);
+    try {
+      if (await waitForStop(running, timeoutMs)) {
+        result = { kind: "default" };
+      } else {
+        this.interrupted = true;
+        this.writeSerialInput("\x03");
+        await waitForStop(running, stopGracePeriodMs);
+        result = { kind: "timeout" };
+      }
+    } catch (e: any) {
+      result = this.interrupted ? { kind: "timeout" } : resultForError(e);
+    }
+    // Before the module is stopped, so it's still valid after a panic.
+    result.gc = this.lastGcStats = module.gcStats();
+    try {
+      // Also abandons a program that ignored Ctrl-C.
+      module.forceStop();
+    } catch (e: any) {
+      if (e.name !== "ExitStatus") {
+        result = { kind: "error", error: e };
+      }
+    }
+    // Called by the HAL for normal shutdown but not in error scenarios.
+    this.stopComponents();
+    this.module = undefined;
+    return { ...result, durationMs: performance.now() - startTime };
+  }
+
+  /**
+   * Schedules an action relative to the start of the program.
+   *
+   * Must be called before run().
+   */
+  schedule(timeMs: number, action: () => void) {
+    this.scheduled.push({ time: timeMs, action });
+  }
+
+  getState(): State {
+    return getBoardState(this);
+  }
+
+  setValue(id: string, value: any) {
+    setBoardValue(this, id, value);
+  }
+
+  ticksMilliseconds() {
+    return this.clock.now();
+  }
+
+  skipMilliseconds(maxMs: number) {
+    return skipForFirmware(this.clock, maxMs);
+  }
+
+  writeSerialInput(text: string) {
+    this.serialInput.writeText(text);
+  }
+
+  /**
+   * Moves as much serial input as fits into target.
+   *
+   * @returns the number of bytes read.
+   */
+  readSerialInput(target: Uint8Array): number {
+    return this.serialInput.read(target);
+  }
+
+  writeSerialOutput(data: Uint8Array): void {
+    // Avoid the KeyboardInterrupt output when we interrupt a timed out program.
+    if (this.interrupted) {
+      return;
+    }
+    if (this.notifications.onSerialOutputBytes) {
+      this.notifications.onSerialOutputBytes(data);
+    } else {
+      // Streaming, as a write can split a character.
+      this.notifications.onSerialOutput(
+        this.decoder.decode(data, { stream: true })
+      );
+    }
+  }
+
+  throwPanic(code: number): void {
+    throw new PanicError(code);
+  }
+
+  throwReset(): void {
+    throw new ResetError();
+  }
+
+  initialize() {
+    // Unlike the browser board we keep serial input written before the
+    // run as it's part of the script.
+    this.clock.reset();
+    this.clearScheduledTimeouts();
+    this.scheduledTimeouts = this.scheduled.map(({ time, action }) =>
+      this.clock.setTimeout(action, time)
+    );
+  }
+
+  stopComponents() {
+    this.clearScheduledTimeouts();
+    this.audio.boardStopped();
+    this.buttons.forEach((b) => b.boardStopped());
+    this.pins.forEach((p) => p.boardStopped());
+    this.display.boardStopped();
+    this.accelerometer.boardStopped();
+    this.compass.boardStopped();
+    this.microphone.boardStopped();
+    this.radio.boardStopped();
+    this.dataLogging.boardStopped();
+    this.serialInput.clear();
+
+    this.notifications.onStateChange(this.getState());
+  }
+
+  private clearScheduledTimeouts() {
+    this.scheduledTimeouts.forEach((timeout) =>
+      this.clock.clearTimeout(timeout)
+    );
+    this.scheduledTimeouts = [];
+  }
+}
+
+/**
+ * The result for the error thrown when the firmware stops abnormally.
+ */
+export const resultForError = (e: any): Omit<HeadlessResult, "durationMs"> => {
+  if (e instanceof PanicError) {
+    return { kind: "panic", panicCode: e.code };
+  }
+  if (e instanceof ResetError) {
+    return { kind: "reset" };
+  }
+  return { kind: "error", error: e };
+};
+
+/**
+ * @returns true if running settled within the timeout, false otherwise.
+ */
+const waitForStop = async (
+  running: Promise<void>,
+  timeoutMs: number
+): Promise<boolean> => {
+  let timeout: any;
+  const timedOut = new Promise<boolean>((resolve) => {
+    timeout = setTimeout(() => resolve(false), timeoutMs);
+  });
+  try {
+    return await Promise.race([running.then(() => true), timedOut]);
+  } finally {
+    clearTimeout(timeout);
+  }
+};
@@ -3,38 +3,44 @@ import svgText from "../bitsflowbit.svg";
 import { Accelerometer } from "./accelerometer";
 import { Audio } from "./audio";
 import { Button } from "./buttons";
-import { Compass } from "./compass";
 import {
-  BITSFLOW_HAL_PIN_FACE,
-  BITSFLOW_HAL_PIN_P0,
-  BITSFLOW_HAL_PIN_P1,
-  BITSFLOW_HAL_PIN_P2,
-  BITSFLOW_HAL_PIN_P3,
-  BITSFLOW_HAL_PIN_P4,
-  BITSFLOW_HAL_PIN_P5,
-  BITSFLOW_HAL_PIN_P6,
-  BITSFLOW_HAL_PIN_P7,
-  BITSFLOW_HAL_PIN_P8,
-  BITSFLOW_HAL_PIN_P9,
-  BITSFLOW_HAL_PIN_P10,
-  BITSFLOW_HAL_PIN_P11,
-  BITSFLOW_HAL_PIN_P12,
-  BITSFLOW_HAL_PIN_P13,
-  BITSFLOW_HAL_PIN_P14,
-  BITSFLOW_HAL_PIN_P15,
-  BITSFLOW_HAL_PIN_P16,
-  BITSFLOW_HAL_PIN_P19,
-  BITSFLOW_HAL_PIN_P20,
-} from "./constants";
+  Clock,
+  defaultYieldBudgetMs,
+  skipForFirmware,
+  WallClock,
+} from "./clock";
+import { Compass } from "./compass";
+import { createPins, getBoardState, setBoardValue } from "./components";
 import * as conversions from "./conversions";
+import { DataLogStore } from "./data-log-store";
 import { DataLogging } from "./data-logging";
 import { Display } from "./display";
+import { PanicError, ResetError } from "./errors";
 import { FileSystem } from "./fs";
 import { Microphone } from "./microphone";
-import { Pin, StubPin, TouchPin } from "./pins";
+import { Pin } from "./pins";
 import { Radio } from "./radio";
+import { SerialInputQueue } from "./serial-input";
+import {
+  isSerialOutputFormat,
+  isValidSerialOutputLatencyMs,
+  SerialOutputBuffer,
+  SerialOutputFormat,
+} from "./serial-output";
 import { RangeSensor, State } from "./state";
-import { ModuleWrapper } from "./wasm";
+import { instantiateFirmware, Stats, StatsCollector } from "./stats";
+import {
+  defaultHeapSize,
+  EmscriptenModule,
+  FirmwareModule,
+  GcStats,
+  isValidHeapSize,
+  ModuleWrapper,
+} from "./wasm";
+import { compileWasm } from "./wasm-cache";
+import { WorkerHost } from "./worker-host";
+
+export { PanicError, ResetError };
 
 enum StopKind {
   /**
@@ -62,27 +68,33 @@ enum StopKind {
   UserStop = "user",
 }
 
-export class PanicError extends Error {
-  constructor(public code: number) {
-    super("panic");
-  }
-}
+const stoppedOpactity = "0.5";
 
-export class ResetError extends Error {
-  constructor() {
-    super("reset");
-  }
+export interface BoardOptions {
+  /**
+   * If set, the firmware runs in a worker loaded from this URL.
+   *
+   * Requires cross-origin isolation for SharedArrayBuffer.
+   */
+  workerUrl?: string;
+  /**
+   * If set with workerUrl, the worker runs the firmware built without
+   * asyncify, which blocks the worker rather than yielding to it.
+   */
+  blocking?: boolean;
 }
 
-const stoppedOpactity = "0.5";
-
-export function createBoard(notifications: Notifications, fs: FileSystem) {
+export function createBoard(
+  notifications: Notifications,
+  fs: FileSystem,
+  options: BoardOptions = {}
+) {
   document.body.insertAdjacentHTML("afterbegin", svgText);
   const svg = document.querySelector("svg");
   if (!svg) {
     throw new Error("No SVG");
   }
-  return new Board(notifications, fs, svg);
+  return new Board(notifications, fs, svg, options);
 }
 
 export class Board {
@@ -100,14 +112,22 @@ export class Board {
   compass: Compass;
   radio: Radio;
   dataLogging: DataLogging;
+  /**
+   * The log as sent to the embedder, whether logged here or in the worker.
+   */
+  logStore = new DataLogStore();
+
+  public serialInput = new SerialInputQueue();
 
-  public serialInputBuffer: number[] = [];
+  clock: Clock = new WallClock();
+  /**
+   * Read by the firmware when it starts.
+   */
+  yieldBudgetMs: number = defaultYieldBudgetMs;
 
   private stoppedOverlay: HTMLDivElement;
   private playButton: HTMLButtonElement;
 
-  private epoch: number | undefined;
-
   // The language and translations can be changed via the "config" message.
   private language: string = "en";
   private translations: Record<string, string> = {
@@ -131,11 +151,35 @@ export class Board {
   /**
    * Defined during start().
    */
-  private modulePromise: Promise<ModuleWrapper> | undefined;
+  private modulePromise: Promise<FirmwareModule> | undefined;
   /**
    * Defined during start().
    */
-  private module: ModuleWrapper | undefined;
+  private module: FirmwareModule | undefined;
+  /**
+   * A module that stopped normally so can be started again, which is much
+   * quicker than creating one.
+   */
+  private idleModule: ModuleWrapper | undefined;
+  /**
+   * Defined while collecting stats, when the firmware runs in this thread.
+   */
+  private stats: StatsCollector | undefined;
+  /**
+   * From the last run, when the firmware runs in this thread.
+   */
+  private lastGcStats: GcStats | undefined;
+  /**
+   * The MicroPython heap size in bytes. Set by flash.
+   */
+  private heapSize: number = defaultHeapSize;
+  /**
+   * Defined if the firmware runs in a worker.
+   *
+   * The components here then mirror the worker's for the UI and user
+   * interactions are forwarded to it.
+   */
+  private worker: WorkerHost | undefined;
   /**
    * Controls the action after the user program completes.
    *
@@ -154,54 +198,47 @@ export class Board {
   constructor(
     private notifications: Notifications,
     private fs: FileSystem,
-    private svg: SVGElement
+    private svg: SVGElement,
+    options: BoardOptions = {}
   ) {
     this.display = new Display(
       Array.from(this.svg.querySelector("#rgb_matrix_led_on")!.querySelectorAll("g[id^='led']"))
     );
     const onChange = this.notifications.onStateChange;
+    // Buttons and pins change via the UI so the worker needs to know.
+    const onUserChange = (change: Partial<State>) => {
+      if (this.worker) {
+        for (const [id, value] of Object.entries(change)) {
+          this.worker.setValue(id, value.value);
+        }
+      }
+      onChange(change);
+    };
     this.buttons = [
       new Button(
         "buttonA",
-        this.svg.querySelector("#ButtonA")!,
-        () => this.formattedMessage({ id: "button-a" }),
-        onChange
+        {
+          element: this.svg.querySelector("#ButtonA")!,
+          label: () => this.formattedMessage({ id: "button-a" }),
+        },
+        onUserChange
       ),
       new Button(
         "buttonB",
-        this.svg.querySelector("#ButtonB")!,
-        () => this.formattedMessage({ id: "button-b" }),
-        onChange
+        {
+          element: this.svg.querySelector("#ButtonB")!,
+          label: () => this.formattedMessage({ id: "button-b" }),
+        },
+        onUserChange
       ),
     ];
-    this.pins = Array(33);
-    this.pins[BITSFLOW_HAL_PIN_FACE] = new TouchPin(
-      "pinLogo",
+    this.pins = createPins(
       {
         element: this.svg.querySelector("#logo")!,
         label: () => this.formattedMessage({ id: "touch-logo" }),
       },
-      onChange
+      onUserChange
     );
-    this.pins[BITSFLOW_HAL_PIN_P0] = new TouchPin("pin0", null, onChange);
-    this.pins[BITSFLOW_HAL_PIN_P1] = new TouchPin("pin1", null, onChange);
-    this.pins[BITSFLOW_HAL_PIN_P2] = new TouchPin("pin2", null, onChange);
-    this.pins[BITSFLOW_HAL_PIN_P3] = new StubPin("pin3");
-    this.pins[BITSFLOW_HAL_PIN_P4] = new StubPin("pin4");
-    this.pins[BITSFLOW_HAL_PIN_P5] = new StubPin("pin5");
-    this.pins[BITSFLOW_HAL_PIN_P6] = new StubPin("pin6");
-    this.pins[BITSFLOW_HAL_PIN_P7] = new StubPin("pin7");
-    this.pins[BITSFLOW_HAL_PIN_P8] = new StubPin("pin8");
-    this.pins[BITSFLOW_HAL_PIN_P9] = new StubPin("pin9");
-    this.pins[BITSFLOW_HAL_PIN_P10] = new StubPin("pin10");
-    this.pins[BITSFLOW_HAL_PIN_P11] = new StubPin("pin11");
-    this.pins[BITSFLOW_HAL_PIN_P12] = new StubPin("pin12");
-    this.pins[BITSFLOW_HAL_PIN_P13] = new StubPin("pin13");
-    this.pins[BITSFLOW_HAL_PIN_P14] = new StubPin("pin14");
-    this.pins[BITSFLOW_HAL_PIN_P15] = new StubPin("pin15");
-    this.pins[BITSFLOW_HAL_PIN_P16] = new StubPin("pin16");
-    this.pins[BITSFLOW_HAL_PIN_P19] = new StubPin("pin19");
-    this.pins[BITSFLOW_HAL_PIN_P20] = new StubPin("pin20");
 
     this.audio = new Audio();
     this.temperature = new RangeSensor("temperature", -5, 50, 21, "°C");
@@ -218,14 +255,53 @@ export class Board {
       onChange,
       currentTimeMillis
     );
+    const onLogOutput = (entry: LogEntry) => {
+      this.logStore.add(entry);
+      this.notifications.onLogOutput(entry);
+    };
+    const onLogDelete = () => {
+      this.logStore.clear();
+      this.notifications.onLogDelete();
+    };
     this.dataLogging = new DataLogging(
       currentTimeMillis,
-      this.notifications.onLogOutput,
+      onLogOutput,
       this.notifications.onSerialOutput,
-      this.notifications.onLogDelete,
+      onLogDelete,
       onChange
     );
 
+    if (options.workerUrl) {
+      this.worker = new WorkerHost(
+        options.workerUrl,
+        {
+          onFrame: (frame) => this.display.setFrame(frame),
+          onSerialOutput: (data) => this.writeSerialOutput(data),
+          onRadioOutput: this.notifications.onRadioOutput,
+          onLogOutput,
+          onLogDelete,
+          onStateChange: this.notifications.onStateChange,
+          onAudioSetting: (setting, value) => {
+            switch (setting) {
+              case "volume": {
+                this.audio.setVolume(value);
+                break;
+              }
+              case "periodUs": {
+                this.audio.setPeriodUs(value);
+                break;
+              }
+              case "amplitudeU10": {
+                this.audio.setAmplitudeU10(value);
+                break;
+              }
+            }
+          },
+        },
+        options.blocking
+      );
+    }
+
     this.stoppedOverlay = document.querySelector(".play-button-container")!;
     this.playButton = document.querySelector(".play-button")!;
     this.initializePlayButton();
@@ -240,15 +316,16 @@ export class Board {
     this.notifications.onReady(this.getState());
   }
 
-  private async createModule(): Promise<ModuleWrapper> {
-    const wrapped = await window.createModule({
-      board: this,
-      fs: this.fs,
-      conversions,
-      noInitialRun: true,
-      instantiateWasm,
-    });
-    const module = new ModuleWrapper(wrapped);
+  private async createModule(): Promise<FirmwareModule> {
+    if (this.worker) {
+      return this.worker.createModule(this.audio.initializeWorker());
+    }
+    const module =
+      this.idleModule ??
+      new ModuleWrapper(await this.createEmscriptenModule());
+    this.idleModule = undefined;
+    // Stopping disposes the audio callbacks so this is needed for each run.
+    const wrapped = module.module;
     this.audio.initializeCallbacks({
       defaultAudioCallback: wrapped._bitsflow_hal_audio_ready_callback,
       speechAudioCallback: wrapped._bitsflow_hal_audio_speech_ready_callback,
@@ -262,6 +339,17 @@ export class Board {
     return module;
   }
 
+  private createEmscriptenModule(): Promise<EmscriptenModule> {
+    return window.createModule({
+      board: this,
+      fs: this.fs,
+      conversions,
+      noInitialRun: true,
+      instantiateWasm: (imports: any, successCallback: any) =>
+        instantiateWasm(imports, successCallback, this.stats),
+    });
+  }
+
   updateTranslations(language: string, translations: Record<string, string>) {
     this.language = language;
     this.translations = translations;
@@ -278,89 +366,50 @@ export class Board {
   }
 
   getState(): State {
-    return {
-      radio: this.radio.state,
-      buttonA: this.buttons[0].state,
-      buttonB: this.buttons[1].state,
-      pinLogo: this.pins[BITSFLOW_HAL_PIN_FACE].state,
-      pin0: this.pins[BITSFLOW_HAL_PIN_P0].state,
-      pin1: this.pins[BITSFLOW_HAL_PIN_P1].state,
-      pin2: this.pins[BITSFLOW_HAL_PIN_P2].state,
-
-      accelerometerX: this.accelerometer.state.accelerometerX,
-      accelerometerY: this.accelerometer.state.accelerometerY,
-      accelerometerZ: this.accelerometer.state.accelerometerZ,
-      gesture: this.accelerometer.state.gesture,
-
-      compassX: this.compass.state.compassX,
-      compassY: this.compass.state.compassY,
-      compassZ: this.compass.state.compassZ,
-      compassHeading: this.compass.state.compassHeading,
-
-      lightLevel: this.display.lightLevel,
-      dataLogging: this.dataLogging.state,
-      soundLevel: this.microphone.soundLevel,
-      temperature: this.temperature,
-    };
+    return getBoardState(this);
   }
 
   setValue(id: string, value: any) {
-    switch (id) {
-      case "accelerometerX":
-      case "accelerometerY":
-      case "accelerometerZ":
-      case "gesture": {
-        this.accelerometer.setValue(id, value);
-        break;
-      }
-      case "compassX":
-      case "compassY":
-      case "compassZ":
-      case "compassHeading": {
-        this.compass.setValue(id, value);
-        break;
-      }
-      case "buttonA": {
-        this.buttons[0].setValue(value);
-        break;
-      }
-      case "buttonB": {
-        this.buttons[1].setValue(value);
-        break;
-      }
-      case "pinLogo": {
-        this.pins[BITSFLOW_HAL_PIN_FACE].setValue(value);
-        break;
-      }
-      case "pin0": {
-        this.pins[BITSFLOW_HAL_PIN_P0].setValue(value);
-        break;
-      }
-      case "pin1": {
-        this.pins[BITSFLOW_HAL_PIN_P1].setValue(value);
-        break;
-      }
-      case "pin2": {
-        this.pins[BITSFLOW_HAL_PIN_P2].setValue(value);
-        break;
-      }
-      case "lightLevel": {
-        this.display.lightLevel.setValue(value);
-        break;
-      }
-      case "soundLevel": {
-        this.microphone.setValue(value);
-        break;
-      }
-      case "temperature": {
-        this.temperature.setValue(value);
-        break;
-      }
+    setBoardValue(this, id, value);
+    this.worker?.setValue(id, value);
+  }
+
+  /**
+   * Optionally starts or stops collecting stats, then notifies of those
+   * collected since the last request along with the GC stats. Starting or
+   * stopping takes effect the next time the program starts.
+   */
+  async requestStats(enabled: boolean | undefined) {
+    if (this.worker) {
+      const { stats, gc } = await this.worker.stats(enabled);
+      this.notifications.onStats(stats, gc);
+      return;
+    }
+    if (enabled !== undefined && enabled !== (this.stats !== undefined)) {
+      this.stats = enabled ? new StatsCollector() : undefined;
+      // So the next start creates a module with or without instrumentation.
+      this.idleModule = undefined;
+    }
+    this.notifications.onStats(
+      this.stats?.take() ?? null,
+      this.module?.gcStats() ?? this.lastGcStats ?? null
+    );
+  }
+
+  radioReceive(data: Uint8Array) {
+    if (this.worker) {
+      this.worker.radioInput(data);
+    } else {
+      this.radio.receive(data);
     }
   }
 
   ticksMilliseconds() {
-    return new Date().getTime() - this.epoch!;
+    return this.clock.now();
+  }
+
+  skipMilliseconds(maxMs: number) {
+    return skipForFirmware(this.clock, maxMs);
   }
 
   private initializePlayButton() {
@@ -414,9 +463,12 @@ export class Board {
     const module = await this.modulePromise;
     this.module = module;
     let panicCode: number | undefined;
+    let reusable = false;
     try {
       this.displayRunningState();
-      await module.start();
+      await module.start(this.heapSize);
+      this.lastGcStats = module.gcStats();
+      reusable = true;
     } catch (e: any) {
       // Take care not to overwrite another kind of stop just because the program
       // called restart or panic.
@@ -432,12 +484,23 @@ export class Board {
       } else {
         this.notifications.onInternalError(e);
       }
+      // Before the snapshot is restored.
+      this.lastGcStats = module.gcStats();
+      // A panic or reset leaves it mid-call, but we know where it stopped.
+      reusable =
+        (e instanceof PanicError || e instanceof ResetError) &&
+        module.restoreSnapshot();
     }
-    try {
-      module.forceStop();
-    } catch (e: any) {
-      if (e.name !== "ExitStatus") {
-        this.notifications.onInternalError(e);
+    if (reusable && module instanceof ModuleWrapper) {
+      // Reused by the next start.
+      this.idleModule = module;
+    } else {
+      try {
+        module.forceStop();
+      } catch (e: any) {
+        if (e.name !== "ExitStatus") {
+          this.notifications.onInternalError(e);
+        }
       }
     }
     // Called by the HAL for normal shutdown but not in error scenarios.
@@ -522,7 +585,10 @@ export class Board {
     this.start();
   }
 
-  async flash(filesystem: Record<string, Uint8Array>): Promise<void> {
+  async flash(
+    filesystem: Record<string, Uint8Array>,
+    heapSize: number = defaultHeapSize
+  ): Promise<void> {
     const flashFileSystem = () => {
       this.fs.clear();
       Object.entries(filesystem).forEach(([name, value]) => {
@@ -534,6 +600,8 @@ export class Board {
     // Ensure it's stopped before flash.
     await this.stop(true);
     flashFileSystem();
+    this.heapSize = heapSize;
+    this.worker?.flash(filesystem);
     return this.start();
   }
 
@@ -647,6 +715,30 @@ export class Board {
     showNextFrame();
   }
 
+  /**
+   * Sets how serial output is combined and sent to the embedder.
+   */
+  configureSerialOutput(
+    latencyMs: number | undefined,
+    format: SerialOutputFormat | undefined
+  ) {
+    this.notifications.configureSerialOutput(latencyMs, format);
+  }
+
+  configureLogOutput(latencyMs: number) {
+    this.notifications.configureLogOutput(latencyMs);
+  }
+
+  /**
+   * Sends the data log as CSV in log_export messages, the last with done set.
+   */
+  exportLog() {
+    for (const chunk of this.logStore.csv()) {
+      this.notifications.onLogExport(chunk, false);
+    }
+    this.notifications.onLogExport("", true);
+  }
+
   mute() {
     this.audio.mute();
   }
@@ -656,35 +748,35 @@ export class Board {
   }
 
   writeSerialInput(text: string) {
-    for (let i = 0; i < text.length; i++) {
-      this.serialInputBuffer.push(text.charCodeAt(i));
+    if (this.worker) {
+      this.worker.writeSerialInput(text);
+      return;
     }
+    this.serialInput.writeText(text);
   }
 
   /**
-   * Read a character code from the serial input buffer or -1 if none.
+   * Moves as much serial input as fits into target.
+   *
+   * @returns the number of bytes read.
    */
-  readSerialInput(): number {
-    return this.serialInputBuffer.shift() ?? -1;
+  readSerialInput(target: Uint8Array): number {
+    return this.serialInput.read(target);
   }
 
-  writeSerialOutput(text: string): void {
+  /**
+   * @param data Text, or UTF-8 that may be a view of the firmware's memory.
+   */
+  writeSerialOutput(data: string | Uint8Array): void {
     // Avoid the Ctrl-C, Ctrl-D output when we request a stop.
     if (this.modulePromise) {
-      this.notifications.onSerialOutput(text);
+      this.notifications.onSerialOutput(data);
     }
   }
 
-  writeRadioRxBuffer(packet: Uint8Array): number {
-    if (!this.module) {
-      throw new Error("Must be running as called via HAL");
-    }
-    return this.module.writeRadioRxBuffer(packet);
-  }
-
   initialize() {
-    this.epoch = new Date().getTime();
-    this.serialInputBuffer.length = 0;
+    this.clock.reset();
+    this.serialInput.clear();
   }
 
   stopComponents() {
@@ -697,7 +789,7 @@ export class Board {
     this.microphone.boardStopped();
     this.radio.boardStopped();
     this.dataLogging.boardStopped();
-    this.serialInputBuffer.length = 0;
+    this.serialInput.clear();
 
     // Nofify of the state resets.
     this.notifications.onStateChange(this.getState());
@@ -713,8 +805,38 @@ export interface LogEntry {
 }
 
 export class Notifications {
+  private serialOutput = new SerialOutputBuffer((data) =>
+    this.postSerialOutput(data)
+  );
+  private serialOutputFormat: SerialOutputFormat = "text";
+  // Streaming, as a flush can split a character.
+  private decoder = new TextDecoder();
+  // Log entries waiting to be sent together. Only used with a latency.
+  private logOutput: LogEntry[] = [];
+  private logOutputLatencyMs = 0;
+  private logOutputTimeout: any;
+
   constructor(private target: Pick<Window, "postMessage">) {}
 
+  configureSerialOutput(
+    latencyMs: number | undefined,
+    format: SerialOutputFormat | undefined
+  ) {
+    // Sent as previously configured.
+    this.serialOutput.flush();
+    if (latencyMs !== undefined) {
+      this.serialOutput.latencyMs = latencyMs;
+    }
+    if (format !== undefined) {
+      this.serialOutputFormat = format;
+    }
+  }
+
+  configureLogOutput(latencyMs: number) {
+    this.flushLogOutput();
+    this.logOutputLatencyMs = latencyMs;
+  }
+
   onReady = (state: State) => {
     this.postMessage("ready", {
       state,
@@ -731,33 +853,89 @@ export class Notifications {
     });
   };
 
-  onSerialOutput = (data: string) => {
-    this.postMessage("serial_output", { data });
+  /**
+   * @param data Text, or UTF-8 that may be a view of the firmware's memory.
+   */
+  onSerialOutput = (data: string | Uint8Array) => {
+    // A print loop would otherwise send thousands of messages a second.
+    if (typeof data === "string") {
+      this.serialOutput.writeText(data);
+    } else {
+      this.serialOutput.write(data);
+    }
   };
 
   onRadioOutput = (data: Uint8Array) => {
-    this.postMessage("radio_output", { data });
+    // The data is a view of the firmware's memory, so copy just the packet.
+    this.postMessage("radio_output", { data: data.slice() });
   };
 
   onLogOutput = (data: LogEntry) => {
-    this.postMessage("log_output", data);
+    if (this.logOutputLatencyMs === 0) {
+      this.postMessage("log_output", data);
+      return;
+    }
+    // Logging at 100Hz would otherwise send a message per row.
+    this.logOutput.push(data);
+    if (this.logOutputTimeout === undefined) {
+      this.logOutputTimeout = setTimeout(
+        () => this.flushLogOutput(),
+        this.logOutputLatencyMs
+      );
+    }
+  };
+
+  onLogExport = (data: string, done: boolean) => {
+    this.postMessage("log_export", { data, done });
   };
 
   onLogDelete = () => {
     this.postMessage("log_delete", {});
   };
 
+  onStats = (stats: Stats | null, gc: GcStats | null) => {
+    this.postMessage("stats", { stats, gc });
+  };
+
   onInternalError = (error: any) => {
     this.postMessage("internal_error", { error });
   };
 
-  private postMessage(kind: string, data: any) {
+  private postSerialOutput(data: Uint8Array) {
+    if (this.serialOutputFormat === "bytes") {
+      this.postMessage("serial_output", { data }, [data.buffer]);
+    } else {
+      this.postMessage("serial_output", {
+        data: this.decoder.decode(data, { stream: true }),
+      });
+    }
+  }
+
+  private flushLogOutput() {
+    clearTimeout(this.logOutputTimeout);
+    this.logOutputTimeout = undefined;
+    if (this.logOutput.length > 0) {
+      const entries = this.logOutput;
+      this.logOutput = [];
+      this.postMessage("log_output_batch", { entries });
+    }
+  }
+
+  private postMessage(kind: string, data: any, transfer?: Transferable[]) {
+    // So the embedder sees output before anything that happened after it.
+    if (kind !== "serial_output") {
+      this.serialOutput.flush();
+    }
+    if (kind !== "log_output_batch") {
+      this.flushLogOutput();
+    }
     this.target.postMessage(
       {
         kind,
         ...data,
       },
-      "*"
+      "*",
+      transfer
     );
   }
 }
@@ -772,11 +950,14 @@ export const createMessageListener = (board: Board) => (e: MessageEvent) => {
         break;
       }
       case "flash": {
-        const { filesystem } = data;
+        const { filesystem, heapSize } = data;
         if (!isFileSystem(filesystem)) {
           throw new Error("Invalid flash filesystem field.");
         }
-        board.flash(filesystem);
+        if (heapSize !== undefined && !isValidHeapSize(heapSize)) {
+          throw new Error("Invalid flash heapSize field.");
+        }
+        board.flash(filesystem, heapSize);
         break;
       }
       case "stop": {
@@ -802,11 +983,45 @@ export const createMessageListener = (board: Board) => (e: MessageEvent) => {
         board.writeSerialInput(data.data);
         break;
       }
+      case "serial_output_config": {
+        const { latencyMs, format } = data;
+        if (
+          latencyMs !== undefined &&
+          !isValidSerialOutputLatencyMs(latencyMs)
+        ) {
+          throw new Error("Invalid serial_output_config latencyMs field.");
+        }
+        if (format !== undefined && !isSerialOutputFormat(format)) {
+          throw new Error("Invalid serial_output_config format field.");
+        }
+        board.configureSerialOutput(latencyMs, format);
+        break;
+      }
+      case "log_output_config": {
+        const { latencyMs } = data;
+        if (!isValidSerialOutputLatencyMs(latencyMs)) {
+          throw new Error("Invalid log_output_config latencyMs field.");
+        }
+        board.configureLogOutput(latencyMs);
+        break;
+      }
+      case "log_export": {
+        board.exportLog();
+        break;
+      }
       case "radio_input": {
         if (!(data.data instanceof Uint8Array)) {
           throw new Error("Invalid radio_input data field.");
         }
-        board.radio.receive(data.data);
+        board.radioReceive(data.data);
+        break;
+      }
+      case "stats": {
+        const { enabled } = data;
+        if (enabled !== undefined && typeof enabled !== "boolean") {
+          throw new Error("Invalid stats enabled field.");
+        }
+        board.requestStats(enabled);
         break;
       }
       case "set_value": {
@@ -832,26 +1047,20 @@ function isFileSystem(
   );
 }
 
-const fetchWasm = async () => {
-  const response = await fetch("./build/firmware.wasm");
-  if (!response.ok) {
-    throw new Error(response.statusText);
-  }
-  return response.arrayBuffer();
-};
-
-const compileWasm = async () => {
-  // Can't use streaming in Safari 14 but would be nice to feature detect.
-  return WebAssembly.compile(new Uint8Array(await fetchWasm()));
-};
-
-let compiledWasmPromise: Promise<WebAssembly.Module> = compileWasm();
+// The dist build rewrites this to the content-hashed name.
+let compiledWasmPromise: Promise<WebAssembly.Module> = compileWasm(
+  "./build/firmware.wasm"
+);
 
-const instantiateWasm = function (imports: any, successCallback: any) {
+const instantiateWasm = function (
+  imports: any,
+  successCallback: any,
+  stats: StatsCollector | undefined
+) {
   // No easy way to communicate failure here so hard to add retries.
   compiledWasmPromise
     .then(async (wasmModule) => {
-      const instance = await WebAssembly.instantiate(wasmModule, imports);
+      const instance = await instantiateFirmware(wasmModule, imports, stats);
       successCallback(instance);
     })
     .catch((e) => {
@@ -19,16 +19,20 @@ export class Microphone {
   private soundLevelCallback: SoundLevelCallback | undefined;
 
   constructor(
-    private element: SVGElement,
+    private element: SVGElement | null,
     private onChange: (changes: Partial<State>) => void
   ) {}
 
   microphoneOn() {
-    this.element.style.fill = "#cd2e3a";
+    if (this.element) {
+      this.element.style.fill = "#cd2e3a";
+    }
   }
 
   private microphoneOff() {
-    this.element.style.fill = "#4D4D4D";
+    if (this.element) {
+      this.element.style.fill = "#4D4D4D";
+    }
   }
 
   setThreshold(threshold: "low" | "high", value: number) {
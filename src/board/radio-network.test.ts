@@ -0,0 +1,89 @@
+import { afterEach, beforeEach, describe, expect, it, vi } from "vitest";
+import { FileSystem } from "./fs";
+import { Firmware, HeadlessBoard } from "./headless";
+import { RadioNetwork, RadioNetworkOptions } from "./radio-network";
+
+const encoder = new TextEncoder();
+const msg = encoder.encode("hello");
+
+const notifications = {
+  onStateChange: () => {},
+  onSerialOutput: () => {},
+  onRadioOutput: () => {},
+  onLogOutput: () => {},
+  onLogDelete: () => {},
+};
+
+// Routing doesn't need the firmware to be running.
+const createBoards = (count: number, options: RadioNetworkOptions = {}) => {
+  const network = new RadioNetwork(options);
+  const boards: HeadlessBoard[] = [];
+  for (let i = 0; i < count; ++i) {
+    const board = network.addBoard(
+      {} as Firmware,
+      new FileSystem(),
+      notifications
+    );
+    board.radio.enable({ maxPayload: 32, queue: 3, group: 1 });
+    boards.push(board);
+  }
+  return boards;
+};
+
+describe("RadioNetwork", () => {
+  beforeEach(() => {
+    vi.useFakeTimers();
+  });
+
+  afterEach(() => {
+    vi.useRealTimers();
+  });
+
+  it("delivers to other boards in the same group", () => {
+    const [sender, sameGroup, otherGroup] = createBoards(3);
+    otherGroup.radio.updateConfig({ maxPayload: 32, queue: 3, group: 2 });
+    sender.radio.send(msg);
+    expect(sender.radio.peek()).toBeUndefined();
+    expect(sameGroup.radio.peek()!.join("")).toContain(msg.join(""));
+    expect(otherGroup.radio.peek()).toBeUndefined();
+  });
+
+  it("doesn't deliver to disabled radios or other channels", () => {
+    const [sender, disabled, otherChannel] = createBoards(3);
+    disabled.radio.disable();
+    otherChannel.radio.updateConfig({
+      maxPayload: 32,
+      queue: 3,
+      group: 1,
+      channel: 10,
+    });
+    // Receiving on a disabled radio would throw.
+    expect(() => sender.radio.send(msg)).not.toThrow();
+    expect(otherChannel.radio.peek()).toBeUndefined();
+  });
+
+  it("drops packets with the loss probability", () => {
+    const random = vi.fn().mockReturnValueOnce(0.1).mockReturnValueOnce(0.9);
+    const [sender, lost, received] = createBoards(3, { loss: 0.5, random });
+    sender.radio.send(msg);
+    expect(lost.radio.peek()).toBeUndefined();
+    expect(received.radio.peek()).toBeDefined();
+  });
+
+  it("delays packets by the latency", () => {
+    const [sender, receiver] = createBoards(2, { latencyMs: 10 });
+    sender.radio.send(msg);
+    expect(receiver.radio.peek()).toBeUndefined();
+    vi.advanceTimersByTime(10);
+    expect(receiver.radio.peek()).toBeDefined();
+  });
+
+  it("sets the RSSI per pair of boards", () => {
+    const [sender, receiver] = createBoards(2, {
+      rssi: (from, to) => -40 - from - to,
+    });
+    sender.radio.send(msg);
+    const packet = receiver.radio.peek()!;
+    expect(packet[1 + msg.length]).toEqual(41);
+  });
+});
@@ -0,0 +1,205 @@
+import { Clock, VirtualClock, WallClock } from "./clock";
+import { FileSystem } from "./fs";
+import {
+  Firmware,
+  HeadlessBoard,
+  HeadlessNotifications,
+  HeadlessResult,
+} from "./headless";
+import { RadioConfig } from "./radio";
+
+// The defaults from drv_radio.h.
+const defaultAddress = 0x75626974;
+const defaultChannel = 7;
+
+export interface RadioNetworkOptions {
+  /**
+   * Skip ahead when every board is idle. See VirtualClock.
+   */
+  virtualTime?: boolean;
+  /**
+   * The delay before other boards receive a packet. Defaults to 0, when
+   * packets are received as they're sent.
+   */
+  latencyMs?: number;
+  /**
+   * The probability that a board misses a packet, from 0 to 1.
+   */
+  loss?: number;
+  /**
+   * The signal strength in dBm for packets between the given boards.
+   * Defaults to the same as for radio_input.
+   */
+  rssi?: number | ((from: number, to: number) => number);
+  /**
+   * Used for packet loss. Can be seeded for repeatable runs.
+   */
+  random?: () => number;
+}
+
+/**
+ * Headless boards that can hear each other's radio, run in one process.
+ *
+ * Like the real radio, boards receive packets sent on the same group,
+ * address, channel and data rate.
+ *
+ * The boards share a clock so time passes for them all together. With
+ * virtual time it only skips ahead when every board is idle.
+ */
+export class RadioNetwork {
+  readonly boards: HeadlessBoard[] = [];
+  private clocks: NetworkClock[] = [];
+  private clock: Clock;
+
+  constructor(private options: RadioNetworkOptions = {}) {
+    this.clock = options.virtualTime ? new VirtualClock() : new WallClock();
+  }
+
+  addBoard(
+    firmware: Firmware,
+    fs: FileSystem,
+    notifications: HeadlessNotifications
+  ): HeadlessBoard {
+    const index = this.boards.length;
+    const clock = new NetworkClock(this.clock, () => this.skip());
+    const board = new HeadlessBoard(
+      firmware,
+      fs,
+      {
+        ...notifications,
+        onRadioOutput: (data) => {
+          notifications.onRadioOutput(data);
+          this.send(index, data);
+        },
+      },
+      clock
+    );
+    this.boards.push(board);
+    this.clocks.push(clock);
+    return board;
+  }
+
+  /**
+   * Runs main.py on every board. See HeadlessBoard.run.
+   */
+  async run(timeoutMs: number): Promise<HeadlessResult[]> {
+    this.clock.reset();
+    return Promise.all(
+      this.boards.map(async (board, i) => {
+        const clock = this.clocks[i];
+        clock.running = true;
+        try {
+          return await board.run(timeoutMs);
+        } finally {
+          clock.running = false;
+        }
+      })
+    );
+  }
+
+  private skip(): boolean {
+    const running = this.clocks.filter((c) => c.running);
+    // Time has to pass normally while any board is busy.
+    if (running.some((c) => c.idleUntil === undefined)) {
+      return false;
+    }
+    const until = Math.min(...running.map((c) => c.idleUntil!));
+    return this.clock.skip(until - this.clock.now());
+  }
+
+  private send(from: number, data: Uint8Array) {
+    const config = this.boards[from].radio.getConfig();
+    if (!config) {
+      return;
+    }
+    const { latencyMs = 0, loss = 0, random = Math.random } = this.options;
+    // The data is a view of the sender's memory that's only valid for now.
+    if (latencyMs > 0) {
+      data = data.slice();
+    }
+    this.boards.forEach((board, to) => {
+      if (to === from || !this.canHear(board, config) || random() < loss) {
+        return;
+      }
+      const receive = () => {
+        // It might have changed its configuration since.
+        if (this.canHear(board, config)) {
+          // Receiving reads the time for the timestamp, which mustn't count
+          // as the board being busy.
+          const { idleUntil } = this.clocks[to];
+          board.radio.receive(data, this.rssi(from, to));
+          this.clocks[to].idleUntil = idleUntil;
+        }
+      };
+      if (latencyMs > 0) {
+        this.clock.setTimeout(receive, latencyMs);
+      } else {
+        receive();
+      }
+    });
+  }
+
+  private canHear(board: HeadlessBoard, sender: RadioConfig): boolean {
+    const config = board.radio.getConfig();
+    return (
+      board.radio.state.enabled &&
+      config !== undefined &&
+      config.group === sender.group &&
+      (config.address ?? defaultAddress) ===
+        (sender.address ?? defaultAddress) &&
+      (config.channel ?? defaultChannel) ===
+        (sender.channel ?? defaultChannel) &&
+      config.dataRate === sender.dataRate
+    );
+  }
+
+  private rssi(from: number, to: number): number | undefined {
+    const { rssi } = this.options;
+    return typeof rssi === "function" ? rssi(from, to) : rssi;
+  }
+}
+
+/**
+ * A board's view of the shared clock.
+ *
+ * A board is idle from when it asks to skip until it next reads the time.
+ * Boards only yield via the HAL, which reads the time first unless it's
+ * about to idle, so while one board runs the others are correctly marked.
+ */
+class NetworkClock implements Clock {
+  running: boolean = false;
+  /**
+   * The time the board wants to idle until, if it's idle.
+   */
+  idleUntil: number | undefined;
+  private epoch: number = 0;
+
+  constructor(private shared: Clock, private skipShared: () => boolean) {}
+
+  get virtual() {
+    return this.shared.virtual;
+  }
+
+  now() {
+    this.idleUntil = undefined;
+    return this.shared.now() - this.epoch;
+  }
+
+  reset() {
+    // Each board's time starts from when it starts, as on real hardware.
+    this.epoch = this.shared.now();
+  }
+
+  skip(maxMs: number) {
+    this.idleUntil = this.shared.now() + maxMs;
+    return this.skipShared();
+  }
+
+  setTimeout(callback: () => void, ms: number): any {
+    return this.shared.setTimeout(callback, ms);
+  }
+
+  clearTimeout(timeout: any) {
+    this.shared.clearTimeout(timeout);
+  }
+}
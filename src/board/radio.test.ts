@@ -85,6 +85,28 @@ describe("Radio", () => {
     expect(radio.peek()).toBeUndefined();
   });
 
+  it("reuses queue space as messages are popped", () => {
+    radio.receive(msg);
+    radio.receive(msg);
+    radio.pop();
+    radio.receive(altMsg);
+    radio.receive(longMsg);
+    radio.pop();
+    expect(radio.peek()!.join("")).toContain(altMsg.join(""));
+    radio.pop();
+    expect(radio.peek()!.join("")).toContain(longMsgTruncated.join(""));
+    expect(radio.peek()!.length).toEqual(32 + 6);
+  });
+
+  it("receives into the given queue", () => {
+    const rx = new Uint8Array(2 + 3 * (32 + 6));
+    radio.disable();
+    radio.enable({ maxPayload: 32, queue: 3, group: 1 }, rx);
+    radio.receive(msg, -40);
+    expect(Array.from(rx.subarray(0, 3))).toEqual([0, 1, msg.length]);
+    expect(rx[3 + msg.length]).toEqual(40);
+  });
+
   it("updates the config group without clearing receive queue", () => {
     radio.receive(msg);
     radio.receive(msg);
@@ -4,10 +4,32 @@ export interface RadioConfig {
   maxPayload: number;
   queue: number;
   group: number;
+  // Only used to decide which boards hear each other, see radio-network.ts.
+  address?: number;
+  channel?: number;
+  dataRate?: number;
 }
 
+// The receive queue layout shared with drv_radio.c.
+const rxRead = 0;
+const rxCount = 1;
+const rxHeader = 2;
+// Length, RSSI and time.
+const packetOverhead = 1 + 1 + 4;
+
+/**
+ * The receive queue size in bytes for the given config.
+ */
+const radioRxQueueSize = (config: RadioConfig) =>
+  rxHeader + config.queue * (config.maxPayload + packetOverhead);
+
 export class Radio {
-  private rxQueue: Uint8Array[] | undefined;
+  /**
+   * A ring of packets, each in a slot of maxPayload + packetOverhead bytes,
+   * after the read index and count. When running the firmware this is in
+   * its memory so packets are written where MicroPython reads them.
+   */
+  private rx: Uint8Array | undefined;
   private config: RadioConfig | undefined;
   state: RadioState = { type: "radio", enabled: false, group: 0 };
 
@@ -18,44 +40,55 @@ export class Radio {
   ) {}
 
   peek(): Uint8Array | undefined {
-    return this.rxQueue![0];
+    const rx = this.rx!;
+    if (rx[rxCount] === 0) {
+      return undefined;
+    }
+    const start = this.slotStart(rx[rxRead]);
+    return rx.subarray(start, start + rx[start] + packetOverhead);
   }
 
   pop() {
-    this.rxQueue!.shift();
+    const rx = this.rx!;
+    if (rx[rxCount] > 0) {
+      rx[rxRead] = (rx[rxRead] + 1) % this.config!.queue;
+      rx[rxCount]--;
+    }
   }
 
   send(data: Uint8Array) {
     this.onSend(data);
   }
 
-  receive(data: Uint8Array) {
-    if (this.rxQueue!.length === this.config!.queue) {
+  getConfig(): RadioConfig | undefined {
+    return this.config;
+  }
+
+  /**
+   * @param rssi The signal strength in dBm.
+   */
+  receive(data: Uint8Array, rssi: number = -127) {
+    const rx = this.rx!;
+    if (rx[rxCount] === this.config!.queue) {
       // Drop the message as the queue is full.
     } else {
       // Truncate at the payload size as we're writing to a fixed size buffer.
       const len = Math.min(data.length, this.config!.maxPayload);
-      data = data.slice(0, len);
+      const time = this.ticksMilliseconds();
       // Add extra information to make a radio packet in the expected format
       // rather than just data. Clients must prepend \x01\x00\x01 if desired.
-      const size =
-        1 + // len
-        len +
-        1 + // RSSI
-        4; // time
-      const rssi = 127; // This is inverted by modradio.
-      const time = this.ticksMilliseconds();
-
-      const packet = new Uint8Array(size);
-      packet[0] = len;
-      packet.set(data, 1);
-      packet[1 + len] = rssi;
-      packet[1 + len + 1] = time & 0xff;
-      packet[1 + len + 2] = (time >> 8) & 0xff;
-      packet[1 + len + 3] = (time >> 16) & 0xff;
-      packet[1 + len + 4] = (time >> 24) & 0xff;
-
-      this.rxQueue!.push(packet);
+      const start = this.slotStart(
+        (rx[rxRead] + rx[rxCount]) % this.config!.queue
+      );
+      rx[start] = len;
+      rx.set(data.subarray(0, len), start + 1);
+      // This is inverted by modradio.
+      rx[start + 1 + len] = Math.min(255, Math.max(0, -rssi));
+      rx[start + 1 + len + 1] = time & 0xff;
+      rx[start + 1 + len + 2] = (time >> 8) & 0xff;
+      rx[start + 1 + len + 3] = (time >> 16) & 0xff;
+      rx[start + 1 + len + 4] = (time >> 24) & 0xff;
+      rx[rxCount]++;
     }
   }
 
@@ -72,6 +105,7 @@ export class Radio {
         "If queue or payload change then should call disable/enable."
       );
     }
+    this.config = config;
 
     if (this.state.group !== config.group) {
       this.state.group = config.group;
@@ -81,9 +115,15 @@ export class Radio {
     }
   }
 
-  enable(config: RadioConfig) {
+  /**
+   * @param rx The receive queue in the firmware's memory. Allocated if not
+   * given, which is only useful when not running the firmware.
+   */
+  enable(config: RadioConfig, rx?: Uint8Array) {
     this.config = config;
-    this.rxQueue = [];
+    this.rx = rx ?? new Uint8Array(radioRxQueueSize(config));
+    this.rx[rxRead] = 0;
+    this.rx[rxCount] = 0;
     if (!this.state.enabled) {
       this.state = {
         ...this.state,
@@ -97,7 +137,7 @@ export class Radio {
   }
 
   disable() {
-    this.rxQueue = undefined;
+    this.rx = undefined;
 
     if (this.state.enabled) {
       this.state.enabled = false;
@@ -107,8 +147,12 @@ export class Radio {
     }
   }
 
+  private slotStart(index: number) {
+    return rxHeader + index * (this.config!.maxPayload + packetOverhead);
+  }
+
   boardStopped() {
-    this.rxQueue = undefined;
+    this.rx = undefined;
     this.config = undefined;
     this.state = {
       type: "radio",
@@ -0,0 +1,42 @@
+import { describe, expect, it } from "vitest";
+import { SerialInputQueue } from "./serial-input";
+
+describe("SerialInputQueue", () => {
+  it("reads in blocks of up to the target size", () => {
+    const queue = new SerialInputQueue();
+    queue.writeText("hello");
+    const target = new Uint8Array(3);
+    expect(queue.read(target)).toEqual(3);
+    expect(Array.from(target)).toEqual([104, 101, 108]);
+    expect(queue.read(target)).toEqual(2);
+    expect(Array.from(target.subarray(0, 2))).toEqual([108, 111]);
+    expect(queue.read(target)).toEqual(0);
+  });
+
+  it("grows to hold large pastes", () => {
+    const queue = new SerialInputQueue();
+    const text = "x".repeat(10000) + "\x04";
+    queue.writeText(text);
+    expect(queue.length).toEqual(text.length);
+    const target = new Uint8Array(text.length);
+    expect(queue.read(target)).toEqual(text.length);
+    expect(target[text.length - 1]).toEqual(4);
+  });
+
+  it("keeps unread input when making room", () => {
+    const queue = new SerialInputQueue();
+    const target = new Uint8Array(200);
+    for (let i = 0; i < 1000; ++i) {
+      queue.push(i % 256);
+      if (queue.length === 250) {
+        queue.read(target);
+      }
+    }
+    const expected = Array.from({ length: 1000 }, (_, i) => i % 256).slice(
+      -queue.length
+    );
+    const rest = new Uint8Array(queue.length);
+    queue.read(rest);
+    expect(Array.from(rest)).toEqual(expected);
+  });
+});
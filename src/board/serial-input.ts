@@ -0,0 +1,61 @@
+/**
+ * Serial input waiting for the firmware, which copies it into its stdin
+ * ring in blocks. See bitsflow_hal_stdin_refill.
+ *
+ * Values are character codes truncated to bytes, as the firmware reads them.
+ */
+export class SerialInputQueue {
+  private buffer = new Uint8Array(256);
+  private start = 0;
+  private end = 0;
+
+  get length(): number {
+    return this.end - this.start;
+  }
+
+  push(charCode: number) {
+    if (this.end === this.buffer.length) {
+      this.makeRoom();
+    }
+    this.buffer[this.end++] = charCode;
+  }
+
+  writeText(text: string) {
+    for (let i = 0; i < text.length; i++) {
+      this.push(text.charCodeAt(i));
+    }
+  }
+
+  /**
+   * Moves as much input as fits into target.
+   *
+   * @returns the number of bytes read.
+   */
+  read(target: Uint8Array): number {
+    const length = Math.min(target.length, this.length);
+    target.set(this.buffer.subarray(this.start, this.start + length));
+    this.start += length;
+    if (this.start === this.end) {
+      this.clear();
+    }
+    return length;
+  }
+
+  clear() {
+    this.start = 0;
+    this.end = 0;
+  }
+
+  private makeRoom() {
+    const length = this.length;
+    if (length * 2 > this.buffer.length) {
+      const buffer = new Uint8Array(this.buffer.length * 2);
+      buffer.set(this.buffer.subarray(this.start, this.end));
+      this.buffer = buffer;
+    } else {
+      this.buffer.copyWithin(0, this.start, this.end);
+    }
+    this.start = 0;
+    this.end = length;
+  }
+}
@@ -0,0 +1,64 @@
+import { afterEach, beforeEach, describe, expect, it, vi } from "vitest";
+import { SerialOutputBuffer } from "./serial-output";
+
+const decoder = new TextDecoder();
+
+describe("SerialOutputBuffer", () => {
+  let flushed: string[] = [];
+  const onFlush = (data: Uint8Array) => flushed.push(decoder.decode(data));
+  let buffer = new SerialOutputBuffer(onFlush);
+
+  beforeEach(() => {
+    vi.useFakeTimers();
+    flushed = [];
+    buffer = new SerialOutputBuffer(onFlush, 16);
+  });
+
+  afterEach(() => {
+    vi.useRealTimers();
+  });
+
+  it("combines output written within the latency", () => {
+    buffer.writeText("a");
+    buffer.writeText("b");
+    vi.advanceTimersByTime(15);
+    expect(flushed).toEqual([]);
+    buffer.writeText("c");
+    vi.advanceTimersByTime(1);
+    expect(flushed).toEqual(["abc"]);
+    vi.advanceTimersByTime(100);
+    expect(flushed).toEqual(["abc"]);
+  });
+
+  it("flushes on demand", () => {
+    buffer.writeText("a");
+    buffer.flush();
+    buffer.flush();
+    expect(flushed).toEqual(["a"]);
+    vi.advanceTimersByTime(100);
+    expect(flushed).toEqual(["a"]);
+  });
+
+  it("flushes large output without waiting", () => {
+    const line = "x".repeat(1024);
+    for (let i = 0; i < 16; ++i) {
+      buffer.writeText(line);
+    }
+    expect(flushed).toEqual([line.repeat(16)]);
+  });
+
+  it("copies the bytes written", () => {
+    const memory = new Uint8Array([104, 105]);
+    buffer.write(memory);
+    memory.fill(0);
+    buffer.flush();
+    expect(flushed).toEqual(["hi"]);
+  });
+
+  it("doesn't buffer with no latency", () => {
+    buffer.latencyMs = 0;
+    buffer.writeText("a");
+    buffer.writeText("b");
+    expect(flushed).toEqual(["a", "b"]);
+  });
+});
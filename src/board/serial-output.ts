@@ -0,0 +1,81 @@
+/**
+ * How long serial output is held to combine it with later output, in
+ * milliseconds. About an animation frame, so a print loop sends tens of
+ * messages a second rather than thousands.
+ */
+export const defaultSerialOutputLatencyMs = 16;
+export const maxSerialOutputLatencyMs = 1000;
+
+/**
+ * How serial output is sent to the embedder. Bytes are UTF-8 in a
+ * transferred Uint8Array.
+ */
+export type SerialOutputFormat = "text" | "bytes";
+
+export const isValidSerialOutputLatencyMs = (
+  latencyMs: any
+): latencyMs is number =>
+  Number.isInteger(latencyMs) &&
+  latencyMs >= 0 &&
+  latencyMs <= maxSerialOutputLatencyMs;
+
+export const isSerialOutputFormat = (
+  format: any
+): format is SerialOutputFormat => format === "text" || format === "bytes";
+
+// Output beyond this is flushed without waiting.
+const maxBufferedLength = 16 * 1024;
+
+/**
+ * Combines serial output written in quick succession.
+ *
+ * Output is kept as the UTF-8 the firmware writes. It's flushed once it's
+ * been held for the latency, or sooner if there's a lot of it. Callers
+ * flush before sending anything else so the embedder sees events in order.
+ */
+export class SerialOutputBuffer {
+  private buffer = new Uint8Array(1024);
+  private length = 0;
+  private timeout: any;
+  private encoder = new TextEncoder();
+
+  constructor(
+    private onFlush: (data: Uint8Array) => void,
+    public latencyMs: number = defaultSerialOutputLatencyMs
+  ) {}
+
+  /**
+   * Copies the data, so it can be a view of the firmware's memory.
+   */
+  write(data: Uint8Array) {
+    if (this.length + data.length > this.buffer.length) {
+      const buffer = new Uint8Array(
+        Math.max(this.buffer.length * 2, this.length + data.length)
+      );
+      buffer.set(this.buffer.subarray(0, this.length));
+      this.buffer = buffer;
+    }
+    this.buffer.set(data, this.length);
+    this.length += data.length;
+    if (this.latencyMs === 0 || this.length >= maxBufferedLength) {
+      this.flush();
+    } else if (this.timeout === undefined) {
+      this.timeout = setTimeout(() => this.flush(), this.latencyMs);
+    }
+  }
+
+  writeText(text: string) {
+    this.write(this.encoder.encode(text));
+  }
+
+  flush() {
+    clearTimeout(this.timeout);
+    this.timeout = undefined;
+    if (this.length > 0) {
+      // A copy the caller owns, so it can be transferred.
+      const data = this.buffer.slice(0, this.length);
+      this.length = 0;
+      this.onFlush(data);
+    }
+  }
+}
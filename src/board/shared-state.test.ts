@@ -0,0 +1,104 @@
+import { describe, expect, it } from "vitest";
+import { SharedBoardState } from "./shared-state";
+
+const drainAll = (state: SharedBoardState) => {
+  const received: Array<[string, any]> = [];
+  state.drain(
+    (charCode) => received.push(["serial", charCode]),
+    (id, value) => received.push([id, value]),
+    (data) => received.push(["radio", Array.from(data)])
+  );
+  return received;
+};
+
+describe("SharedBoardState", () => {
+  it("delivers input in order", () => {
+    const main = new SharedBoardState();
+    const worker = new SharedBoardState(main.buffer);
+    main.writeSerialInput(65);
+    main.setValue("buttonA", 1);
+    main.setValue("temperature", "30");
+    main.setValue("gesture", "shake");
+    expect(drainAll(worker)).toEqual([
+      ["serial", 65],
+      ["buttonA", 1],
+      ["temperature", 30],
+      ["gesture", "shake"],
+    ]);
+    expect(drainAll(worker)).toEqual([]);
+  });
+
+  it("ignores unsupported ids", () => {
+    const state = new SharedBoardState();
+    expect(state.setValue("radio", {})).toEqual(false);
+    expect(drainAll(state)).toEqual([]);
+  });
+
+  it("rejects input when full and accepts more once drained", () => {
+    const state = new SharedBoardState();
+    let written = 0;
+    while (state.writeSerialInput(written % 256)) {
+      written++;
+    }
+    expect(written).toEqual(4096);
+    expect(drainAll(state).length).toEqual(4096);
+    // Now wraps around the ring.
+    for (let i = 0; i < 10; ++i) {
+      expect(state.writeSerialInput(i)).toEqual(true);
+    }
+    expect(drainAll(state).map(([, value]) => value)).toEqual([
+      0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+    ]);
+  });
+
+  it("delivers radio packets across the end of the ring", () => {
+    const main = new SharedBoardState();
+    const worker = new SharedBoardState(main.buffer);
+    for (let i = 0; i < 4094; ++i) {
+      main.writeSerialInput(0);
+    }
+    drainAll(worker);
+    const packet = Array.from({ length: 20 }, (_, i) => i + 1);
+    expect(main.writeRadioInput(new Uint8Array(packet))).toEqual(true);
+    main.writeSerialInput(65);
+    expect(drainAll(worker)).toEqual([
+      ["radio", packet],
+      ["serial", 65],
+    ]);
+  });
+
+  it("rejects packets that don't fit", () => {
+    const state = new SharedBoardState();
+    for (let i = 0; i < 4094; ++i) {
+      state.writeSerialInput(0);
+    }
+    expect(state.writeRadioInput(new Uint8Array(9))).toEqual(false);
+    expect(state.writeRadioInput(new Uint8Array(8))).toEqual(true);
+  });
+
+  it("doesn't wait when there's input", () => {
+    const state = new SharedBoardState();
+    state.writeSerialInput(65);
+    const start = Date.now();
+    state.waitForInput(1000);
+    expect(Date.now() - start).toBeLessThan(500);
+  });
+
+  it("publishes frames with a sequence number", () => {
+    const main = new SharedBoardState();
+    const worker = new SharedBoardState(main.buffer);
+    const frame = new Uint8Array(25);
+    expect(main.readFrame(frame, 0)).toEqual(0);
+    worker.writeFrame(new Array(25).fill(9));
+    const sequence = main.readFrame(frame, 0);
+    expect(sequence).toEqual(1);
+    expect(Array.from(frame)).toEqual(new Array(25).fill(9));
+  });
+
+  it("stops only the requested run", () => {
+    const state = new SharedBoardState();
+    state.requestStop(2);
+    expect(state.isStopRequested(1)).toEqual(false);
+    expect(state.isStopRequested(2)).toEqual(true);
+  });
+});
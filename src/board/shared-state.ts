@@ -0,0 +1,216 @@
+import {
+  convertAccelerometerNumberToString,
+  convertAccelerometerStringToNumber,
+} from "./conversions";
+
+/**
+ * Board state shared between the main thread and a worker running the
+ * firmware, via a SharedArrayBuffer.
+ *
+ * Input is a single producer, single consumer ring of (id, value) pairs
+ * written by the main thread. The worker drains it whenever the firmware
+ * processes events so it sees input without yielding to its event loop.
+ * A radio packet is a pair with its length followed by pairs holding its
+ * bytes, so the blocking firmware, which never yields, can receive them.
+ *
+ * The display frame is written by the worker and polled by the main thread
+ * when it renders.
+ */
+
+// The ids of values that can be set from the main thread.
+// The ring id is the index in this array plus one. Zero is serial input.
+const valueIds = [
+  "buttonA",
+  "buttonB",
+  "pinLogo",
+  "pin0",
+  "pin1",
+  "pin2",
+  "accelerometerX",
+  "accelerometerY",
+  "accelerometerZ",
+  "gesture",
+  "compassX",
+  "compassY",
+  "compassZ",
+  "compassHeading",
+  "lightLevel",
+  "soundLevel",
+  "temperature",
+];
+const serialInputId = 0;
+const radioInputId = -1;
+const bytesPerPair = 8;
+
+// In pairs. Must be a power of two.
+const ringCapacity = 4096;
+
+// Int32 offsets into the buffer.
+const stopRunIdSlot = 0;
+const frameSequenceSlot = 1;
+const ringReadSlot = 2;
+const ringWriteSlot = 3;
+const frameSlot = 4;
+const frameLength = 25;
+const ringSlot = frameSlot + frameLength;
+const slotCount = ringSlot + ringCapacity * 2;
+
+// The Int32 offset of the pair at the given ring position.
+const pairOffset = (position: number) =>
+  ringSlot + (position & (ringCapacity - 1)) * 2;
+
+export class SharedBoardState {
+  private view: Int32Array;
+  private bytes: Uint8Array;
+
+  constructor(
+    readonly buffer: SharedArrayBuffer = new SharedArrayBuffer(slotCount * 4)
+  ) {
+    this.view = new Int32Array(buffer);
+    this.bytes = new Uint8Array(buffer);
+  }
+
+  // Main thread.
+
+  /**
+   * @returns false if the ring is full.
+   */
+  writeSerialInput(charCode: number): boolean {
+    return this.push(serialInputId, charCode);
+  }
+
+  /**
+   * @returns false if the ring is full or the id isn't supported.
+   */
+  setValue(id: string, value: any): boolean {
+    const index = valueIds.indexOf(id);
+    if (index === -1) {
+      return false;
+    }
+    const encoded =
+      id === "gesture"
+        ? convertAccelerometerStringToNumber(value)
+        : typeof value === "string"
+        ? parseInt(value, 10)
+        : value;
+    return this.push(index + 1, encoded);
+  }
+
+  /**
+   * @returns false if the ring doesn't have room for the packet.
+   */
+  writeRadioInput(data: Uint8Array): boolean {
+    return this.push(radioInputId, data.length, data);
+  }
+
+  /**
+   * Asks the worker to stop the given run.
+   */
+  requestStop(runId: number) {
+    Atomics.store(this.view, stopRunIdSlot, runId);
+    // Wakes waitForInput.
+    Atomics.notify(this.view, ringWriteSlot);
+  }
+
+  /**
+   * Copies the display frame if it has changed.
+   *
+   * @returns the sequence number of the current frame.
+   */
+  readFrame(target: Uint8Array, lastSequence: number): number {
+    const sequence = Atomics.load(this.view, frameSequenceSlot);
+    if (sequence !== lastSequence) {
+      for (let i = 0; i < frameLength; ++i) {
+        target[i] = this.view[frameSlot + i];
+      }
+    }
+    return sequence;
+  }
+
+  // Worker.
+
+  isStopRequested(runId: number): boolean {
+    return Atomics.load(this.view, stopRunIdSlot) === runId;
+  }
+
+  /**
+   * Takes all pending input from the ring.
+   */
+  drain(
+    onSerialInput: (charCode: number) => void,
+    onValue: (id: string, value: any) => void,
+    onRadioInput: (data: Uint8Array) => void
+  ) {
+    const write = Atomics.load(this.view, ringWriteSlot);
+    let read = Atomics.load(this.view, ringReadSlot);
+    while (read !== write) {
+      const offset = pairOffset(read);
+      const id = this.view[offset];
+      const value = this.view[offset + 1];
+      if (id === serialInputId) {
+        onSerialInput(value);
+      } else if (id === radioInputId) {
+        const data = new Uint8Array(value);
+        for (let i = 0; i < value; i += bytesPerPair) {
+          read = (read + 1) | 0;
+          const start = pairOffset(read) * 4;
+          const length = Math.min(bytesPerPair, value - i);
+          data.set(this.bytes.subarray(start, start + length), i);
+        }
+        onRadioInput(data);
+      } else {
+        const valueId = valueIds[id - 1];
+        onValue(
+          valueId,
+          valueId === "gesture"
+            ? convertAccelerometerNumberToString(value)
+            : value
+        );
+      }
+      read = (read + 1) | 0;
+    }
+    Atomics.store(this.view, ringReadSlot, read);
+  }
+
+  /**
+   * Waits for up to ms for input or a stop request, unless there's input
+   * already. Only the blocking firmware waits like this, as it can't yield.
+   */
+  waitForInput(ms: number) {
+    const write = Atomics.load(this.view, ringWriteSlot);
+    if (write === Atomics.load(this.view, ringReadSlot)) {
+      Atomics.wait(this.view, ringWriteSlot, write, ms);
+    }
+  }
+
+  writeFrame(frame: ArrayLike<number>) {
+    for (let i = 0; i < frameLength; ++i) {
+      this.view[frameSlot + i] = frame[i];
+    }
+    // Publishes the frame to the main thread.
+    Atomics.add(this.view, frameSequenceSlot, 1);
+  }
+
+  private push(id: number, value: number, data?: Uint8Array): boolean {
+    const pairs = 1 + (data ? Math.ceil(data.length / bytesPerPair) : 0);
+    const write = Atomics.load(this.view, ringWriteSlot);
+    const read = Atomics.load(this.view, ringReadSlot);
+    if (((write - read) | 0) > ringCapacity - pairs) {
+      return false;
+    }
+    const offset = pairOffset(write);
+    this.view[offset] = id;
+    this.view[offset + 1] = value;
+    for (let i = 1; i < pairs; ++i) {
+      const start = (i - 1) * bytesPerPair;
+      this.bytes.set(
+        data!.subarray(start, start + bytesPerPair),
+        pairOffset((write + i) | 0) * 4
+      );
+    }
+    Atomics.store(this.view, ringWriteSlot, (write + pairs) | 0);
+    Atomics.notify(this.view, ringWriteSlot);
+    return true;
+  }
+}
+
@@ -0,0 +1,64 @@
+import { describe, expect, it } from "vitest";
+import { StatsCollector } from "./stats";
+
+// Stands in for the firmware's imports and exports.
+const createImports = () => {
+  const env = {
+    mp_js_hal_display_set_pixel: (x: number, y: number, value: number) =>
+      x + y + value,
+    emscripten_sleep: () => {},
+    memory: "memory",
+  };
+  return { env, wasi_snapshot_preview1: env };
+};
+
+const createInstance = () =>
+  ({
+    exports: {
+      asyncify_start_unwind: (data: number) => data,
+      bitsflow_hal_gesture_callback: (gesture: number) => gesture,
+      mp_js_main: () => {},
+    },
+  } as unknown as WebAssembly.Instance);
+
+describe("StatsCollector", () => {
+  it("counts HAL calls", () => {
+    const stats = new StatsCollector();
+    const imports = stats.instrumentImports(createImports());
+    const setPixel = imports.env.mp_js_hal_display_set_pixel as Function;
+    expect(setPixel(1, 2, 3)).toEqual(6);
+    setPixel(0, 0, 0);
+    // Only HAL calls are wrapped.
+    expect(imports.env.memory).toEqual("memory");
+
+    const taken = stats.take();
+    expect(Object.keys(taken.hal)).toEqual(["mp_js_hal_display_set_pixel"]);
+    expect(taken.hal.mp_js_hal_display_set_pixel.calls).toEqual(2);
+  });
+
+  it("counts unwinds and callbacks", () => {
+    const stats = new StatsCollector();
+    const { exports } = stats.instrumentInstance(createInstance());
+    (exports.asyncify_start_unwind as Function)(1);
+    (exports.asyncify_start_unwind as Function)(1);
+    expect((exports.bitsflow_hal_gesture_callback as Function)(4)).toEqual(4);
+
+    const taken = stats.take();
+    expect(taken.unwinds).toEqual(2);
+    expect(taken.callbacks).toEqual({ bitsflow_hal_gesture_callback: 1 });
+  });
+
+  it("resets when taken", () => {
+    const stats = new StatsCollector();
+    const imports = stats.instrumentImports(createImports());
+    const { exports } = stats.instrumentInstance(createInstance());
+    (imports.env.mp_js_hal_display_set_pixel as Function)(0, 0, 0);
+    (exports.asyncify_start_unwind as Function)(1);
+    stats.take();
+
+    const taken = stats.take();
+    expect(taken.hal).toEqual({});
+    expect(taken.unwinds).toEqual(0);
+    expect(taken.callbacks).toEqual({});
+  });
+});
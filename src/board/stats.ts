@@ -0,0 +1,157 @@
+/**
+ * Optional instrumentation of the boundary between the firmware and
+ * JavaScript, to find out what a program that pins a CPU core is doing.
+ *
+ * The firmware's imports and exports are wrapped when the module is
+ * instantiated, so there's no cost unless a collector is in use.
+ */
+
+export interface HalCallStats {
+  /**
+   * Async calls count twice, once to unwind and again on resuming.
+   */
+  calls: number;
+  /**
+   * Time spent in JavaScript, excluding any time asleep.
+   */
+  totalMs: number;
+}
+
+export interface Stats {
+  /**
+   * The period covered, since collection started or the stats were taken.
+   */
+  durationMs: number;
+  /**
+   * By import name, e.g. mp_js_hal_display_set_pixel.
+   */
+  hal: Record<string, HalCallStats>;
+  /**
+   * Times the firmware unwound its stack to yield to JavaScript, e.g. in
+   * emscripten_sleep or an async HAL call.
+   */
+  unwinds: number;
+  unwindsPerSecond: number;
+  /**
+   * Calls from JavaScript to the firmware's callbacks, which schedule
+   * work such as refilling audio or running gesture handlers, by name.
+   */
+  callbacks: Record<string, number>;
+}
+
+const halPrefix = "mp_js_";
+const callbackPattern = /^bitsflow_hal_.*_callback$/;
+
+export class StatsCollector {
+  private hal = new Map<string, HalCallStats>();
+  private callbacks = new Map<string, number>();
+  private unwinds = 0;
+  private startTime = performance.now();
+
+  /**
+   * @returns imports that count and time the HAL calls.
+   */
+  instrumentImports(imports: WebAssembly.Imports): WebAssembly.Imports {
+    const instrumented: WebAssembly.Imports = {};
+    for (const [module, moduleImports] of Object.entries(imports)) {
+      instrumented[module] = Object.fromEntries(
+        Object.entries(moduleImports).map(([name, value]) => [
+          name,
+          name.startsWith(halPrefix) && typeof value === "function"
+            ? this.wrapImport(name, value)
+            : value,
+        ])
+      );
+    }
+    return instrumented;
+  }
+
+  /**
+   * @returns an instance whose exports count unwinds and callbacks.
+   */
+  instrumentInstance(instance: WebAssembly.Instance): WebAssembly.Instance {
+    const exports: WebAssembly.Exports = { ...instance.exports };
+    for (const [name, value] of Object.entries(instance.exports)) {
+      if (callbackPattern.test(name) && typeof value === "function") {
+        exports[name] = this.wrapCallback(name, value);
+      }
+    }
+    // Not exported by the blocking firmware, which never unwinds.
+    const startUnwind = instance.exports.asyncify_start_unwind as Function;
+    if (startUnwind) {
+      exports.asyncify_start_unwind = (data: number) => {
+        this.unwinds++;
+        return startUnwind(data);
+      };
+    }
+    // Emscripten only uses the exports.
+    return { exports };
+  }
+
+  /**
+   * @returns the stats since collection started or they were last taken.
+   */
+  take(): Stats {
+    const now = performance.now();
+    const durationMs = now - this.startTime;
+    const hal: Record<string, HalCallStats> = {};
+    this.hal.forEach((stats, name) => {
+      if (stats.calls > 0) {
+        hal[name] = { ...stats };
+      }
+      stats.calls = 0;
+      stats.totalMs = 0;
+    });
+    const result: Stats = {
+      durationMs,
+      hal,
+      unwinds: this.unwinds,
+      unwindsPerSecond:
+        durationMs > 0 ? (this.unwinds * 1000) / durationMs : 0,
+      callbacks: Object.fromEntries(this.callbacks),
+    };
+    this.callbacks.clear();
+    this.unwinds = 0;
+    this.startTime = now;
+    return result;
+  }
+
+  private wrapImport(name: string, f: Function): Function {
+    const stats = this.hal.get(name) ?? { calls: 0, totalMs: 0 };
+    this.hal.set(name, stats);
+    return (...args: any[]) => {
+      const start = performance.now();
+      try {
+        return f(...args);
+      } finally {
+        stats.calls++;
+        stats.totalMs += performance.now() - start;
+      }
+    };
+  }
+
+  private wrapCallback(name: string, f: Function): Function {
+    return (...args: any[]) => {
+      this.callbacks.set(name, (this.callbacks.get(name) ?? 0) + 1);
+      return f(...args);
+    };
+  }
+}
+
+/**
+ * Instantiates the firmware, instrumented if stats are given.
+ */
+export const instantiateFirmware = async (
+  wasm: WebAssembly.Module,
+  imports: WebAssembly.Imports,
+  stats: StatsCollector | undefined
+): Promise<WebAssembly.Instance> => {
+  if (!stats) {
+    return WebAssembly.instantiate(wasm, imports);
+  }
+  const instance = await WebAssembly.instantiate(
+    wasm,
+    stats.instrumentImports(imports)
+  );
+  return stats.instrumentInstance(instance);
+};
@@ -0,0 +1,83 @@
+/**
+ * Compiles the firmware, reusing a previously compiled module if we have one.
+ *
+ * Compiled modules are kept in IndexedDB where the browser supports storing
+ * them. Elsewhere streaming compilation of a content-hashed URL lets the
+ * browser use its own code cache.
+ */
+
+const dbName = "firmware";
+const storeName = "modules";
+
+/**
+ * Only content-hashed URLs are cached as otherwise we can't tell if the
+ * firmware has changed. See bin/hash-assets.js.
+ */
+const isContentHashed = (url: string) => /\.[0-9a-f]{8,}\.wasm$/.test(url);
+
+export const compileWasm = async (
+  url: string
+): Promise<WebAssembly.Module> => {
+  const key = new URL(url, location.href).href;
+  if (!isContentHashed(key) || typeof indexedDB === "undefined") {
+    return compileWasmFromNetwork(url);
+  }
+  let db: IDBDatabase | undefined;
+  try {
+    db = await openDatabase();
+    const cached = await requestResult(
+      db.transaction(storeName).objectStore(storeName).get(key)
+    );
+    if (cached instanceof WebAssembly.Module) {
+      return cached;
+    }
+  } catch (e) {
+    // Private browsing or similar. Carry on without the cache.
+  }
+  const module = await compileWasmFromNetwork(url);
+  if (db) {
+    try {
+      const store = db
+        .transaction(storeName, "readwrite")
+        .objectStore(storeName);
+      // Only the current firmware is useful.
+      store.clear();
+      await requestResult(store.put(module, key));
+    } catch (e) {
+      // Most browsers no longer support storing modules (DataCloneError).
+    }
+  }
+  return module;
+};
+
+const compileWasmFromNetwork = async (
+  url: string
+): Promise<WebAssembly.Module> => {
+  // Not available in Safari 14.
+  if (typeof WebAssembly.compileStreaming === "function") {
+    try {
+      return await WebAssembly.compileStreaming(fetch(url));
+    } catch (e) {
+      // For example, if the server sends the wrong Content-Type.
+    }
+  }
+  const response = await fetch(url);
+  if (!response.ok) {
+    throw new Error(response.statusText);
+  }
+  return WebAssembly.compile(new Uint8Array(await response.arrayBuffer()));
+};
+
+const openDatabase = (): Promise<IDBDatabase> =>
+  new Promise((resolve, reject) => {
+    const request = indexedDB.open(dbName, 1);
+    request.onupgradeneeded = () => request.result.createObjectStore(storeName);
+    request.onsuccess = () => resolve(request.result);
+    request.onerror = () => reject(request.error);
+  });
+
+const requestResult = <T>(request: IDBRequest<T>): Promise<T> =>
+  new Promise((resolve, reject) => {
+    request.onsuccess = () => resolve(request.result);
+    request.onerror = () => reject(request.error);
+  });
@@ -0,0 +1,52 @@
+import { describe, expect, it } from "vitest";
+import {
+  defaultHeapSize,
+  EmscriptenModule,
+  isValidHeapSize,
+  ModuleWrapper,
+} from "./wasm";
+
+describe("isValidHeapSize", () => {
+  it("accepts sizes within the limits", () => {
+    expect(isValidHeapSize(defaultHeapSize)).toEqual(true);
+    expect(isValidHeapSize(1024 * 1024)).toEqual(true);
+  });
+
+  it("rejects others", () => {
+    expect(isValidHeapSize(1024)).toEqual(false);
+    expect(isValidHeapSize(64 * 1024 * 1024)).toEqual(false);
+    expect(isValidHeapSize(65536.5)).toEqual(false);
+    expect(isValidHeapSize("65536")).toEqual(false);
+  });
+});
+
+describe("ModuleWrapper", () => {
+  it("reads the GC stats from the firmware", () => {
+    const memory = new ArrayBuffer(256);
+    const statsAddress = 64;
+    new Float64Array(memory, statsAddress).set([
+      65536, 3, 1.5, 0.75, 10000, 4096, 60000, 61440, 15360,
+    ]);
+    const module = {
+      cwrap: () => () => Promise.resolve(),
+      HEAPU8: new Uint8Array(memory),
+      HEAPF64: new Float64Array(memory),
+      _mp_js_heap_top: () => 32,
+      _mp_js_gc_stats: () => statsAddress,
+      stackSave: () => 0,
+    } as unknown as EmscriptenModule;
+
+    expect(new ModuleWrapper(module).gcStats()).toEqual({
+      heapSize: 65536,
+      collections: 3,
+      pauseTotalMs: 1.5,
+      pauseMaxMs: 0.75,
+      bytesAllocated: 10000,
+      used: 4096,
+      peakUsed: 60000,
+      free: 61440,
+      largestFree: 15360,
+      fragmentation: 0.75,
+    });
+  });
+});
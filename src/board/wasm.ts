@@ -1,6 +1,7 @@
-import { Board } from ".";
+import type { Board } from ".";
 import * as conversions from "./conversions";
 import { FileSystem } from "./fs";
+import type { HeadlessBoard } from "./headless";
 
 export interface EmscriptenModule {
   cwrap: any;
@@ -9,35 +10,111 @@ export interface EmscriptenModule {
   // See EXPORTED_FUNCTIONS in the Makefile.
   _mp_js_request_stop(): void;
   _mp_js_force_stop(): void;
+  _mp_js_heap_top(): number;
+  _mp_js_gc_stats(): number;
   _bitsflow_hal_audio_ready_callback(): void;
   _bitsflow_hal_audio_speech_ready_callback(): void;
   _bitsflow_hal_gesture_callback(gesture: number): void;
   _bitsflow_hal_level_detector_callback(level: number): void;
-  _bitsflow_radio_rx_buffer(): number;
+  _sound_synth_pull(): number;
 
   HEAPU8: Uint8Array;
+  HEAPF32: Float32Array;
+  HEAPF64: Float64Array;
+  stackSave(): number;
+  stackRestore(stackPointer: number): void;
 
   // Added by us at module creation time for jshal to access.
-  board: Board;
+  board: Board | HeadlessBoard;
   fs: FileSystem;
   conversions: typeof conversions;
 }
 
-export class ModuleWrapper {
-  private main: () => Promise<void>;
+/**
+ * The MicroPython heap size used by the device.
+ */
+export const defaultHeapSize = 64 * 1024;
+/**
+ * Limits on the configurable heap size. The Wasm memory is fixed at 16MB.
+ */
+export const minHeapSize = 16 * 1024;
+export const maxHeapSize = 8 * 1024 * 1024;
 
-  constructor(private module: EmscriptenModule) {
+export const isValidHeapSize = (heapSize: any): heapSize is number =>
+  Number.isInteger(heapSize) &&
+  heapSize >= minHeapSize &&
+  heapSize <= maxHeapSize;
+
+/**
+ * MicroPython GC stats for a run. Sizes are in bytes.
+ */
+export interface GcStats {
+  heapSize: number;
+  collections: number;
+  pauseTotalMs: number;
+  pauseMaxMs: number;
+  /**
+   * Total allocated during the run, including memory since freed.
+   */
+  bytesAllocated: number;
+  used: number;
+  peakUsed: number;
+  free: number;
+  /**
+   * The largest allocation that would currently succeed.
+   */
+  largestFree: number;
+  /**
+   * From 0 when the free memory is contiguous towards 1 when it's split
+   * into many small blocks so large allocations fail.
+   */
+  fragmentation: number;
+}
+
+/**
+ * A running instance of the firmware, either in this thread or a worker.
+ */
+export interface FirmwareModule {
+  start(heapSize: number): Promise<void>;
+  requestStop(): void;
+  forceStop(): void;
+  /**
+   * Returns the module to its state when it was created so it can be
+   * started again after a panic or reset.
+   *
+   * @returns false if that isn't possible.
+   */
+  restoreSnapshot(): boolean;
+  /**
+   * @returns the stats for the current run, or the last one if it stopped
+   * normally. Undefined if the module can't report them.
+   */
+  gcStats(): GcStats | undefined;
+}
+
+export class ModuleWrapper implements FirmwareModule {
+  private main: (heapSize: number) => Promise<void> | void;
+  private snapshot: Uint8Array;
+  private snapshotStackPointer: number;
+
+  constructor(readonly module: EmscriptenModule, blocking: boolean = false) {
+    // The blocking firmware returns when it stops.
     const main = module.cwrap("mp_js_main", "null", ["number"], {
-      async: true,
+      async: !blocking,
     });
-    this.main = () => main(64 * 1024);
+    this.main = (heapSize) => main(heapSize);
+    // The runtime is initialized but nothing has run yet. The C heap is at
+    // the top so this covers all the state. Stopping mid-call leaves the
+    // Wasm globals other than the stack pointer as they were.
+    this.snapshot = module.HEAPU8.slice(0, module._mp_js_heap_top());
+    this.snapshotStackPointer = module.stackSave();
   }
 
   /**
    * Throws PanicError if MicroPython panics.
    */
-  async start(): Promise<void> {
-    return this.main!();
+  async start(heapSize: number): Promise<void> {
+    return this.main!(heapSize);
   }
 
   requestStop(): void {
@@ -48,9 +125,39 @@ export class ModuleWrapper {
     this.module._mp_js_force_stop();
   }
 
-  writeRadioRxBuffer(packet: Uint8Array) {
-    const buf = this.module._bitsflow_radio_rx_buffer!();
-    this.module.HEAPU8.set(packet, buf);
-    return buf;
+  restoreSnapshot(): boolean {
+    const heap = this.module.HEAPU8;
+    heap.set(this.snapshot);
+    // malloc expects memory it hasn't used yet to be zeroed.
+    heap.fill(0, this.snapshot.length);
+    this.module.stackRestore(this.snapshotStackPointer);
+    return true;
+  }
+
+  gcStats(): GcStats {
+    // See mp_js_gc_stats_t in main.c.
+    const [
+      heapSize,
+      collections,
+      pauseTotalMs,
+      pauseMaxMs,
+      bytesAllocated,
+      used,
+      peakUsed,
+      free,
+      largestFree,
+    ] = this.module.HEAPF64.subarray(this.module._mp_js_gc_stats() >> 3);
+    return {
+      heapSize,
+      collections,
+      pauseTotalMs,
+      pauseMaxMs,
+      bytesAllocated,
+      used,
+      peakUsed,
+      free,
+      largestFree,
+      fragmentation: free > 0 ? 1 - largestFree / free : 0,
+    };
   }
 }
@@ -0,0 +1,96 @@
+import { describe, expect, it, vi } from "vitest";
+import { AudioRing } from "./audio/ring";
+import { FileSystem } from "./fs";
+import { Firmware } from "./headless";
+import { SharedBoardState } from "./shared-state";
+import { EmscriptenModule } from "./wasm";
+import { WorkerBoard } from "./worker-board";
+
+const notifications = {
+  onStateChange: () => {},
+  onSerialOutput: () => {},
+  onRadioOutput: () => {},
+  onLogOutput: () => {},
+  onLogDelete: () => {},
+};
+
+/**
+ * Enough of the firmware to start a module whose program just starts
+ * speaking.
+ */
+const createFirmware = () => {
+  const speechCallback = vi.fn();
+  const createModule = vi.fn(
+    async ({ board }: any) =>
+      ({
+        cwrap: () => async () => {
+          const speech = board.audio.speech!;
+          speech.init(8000);
+          const buffer = speech.createBuffer(80);
+          buffer.getChannelData(0).fill(0.5);
+          // The first buffer asks for another straight away.
+          speech.writeData(buffer);
+          // Long enough for a ring to ask but not for the buffer to play.
+          await new Promise((resolve) => setTimeout(resolve, 0));
+        },
+        HEAPU8: new Uint8Array(16),
+        HEAPF64: new Float64Array(16),
+        stackSave: () => 0,
+        stackRestore: () => {},
+        _mp_js_heap_top: () => 16,
+        _mp_js_gc_stats: () => 0,
+        _bitsflow_hal_audio_ready_callback: () => {},
+        _bitsflow_hal_audio_speech_ready_callback: speechCallback,
+        _bitsflow_hal_gesture_callback: () => {},
+        _bitsflow_hal_level_detector_callback: () => {},
+      } as unknown as EmscriptenModule)
+  );
+  const firmware: Firmware = {
+    createModule,
+    wasm: {} as WebAssembly.Module,
+  };
+  return { firmware, createModule, speechCallback };
+};
+
+describe("WorkerBoard", () => {
+  it("connects the audio callbacks each time a module is reused", async () => {
+    const { firmware, createModule, speechCallback } = createFirmware();
+    const board = new WorkerBoard(
+      firmware,
+      new FileSystem(),
+      notifications,
+      new SharedBoardState()
+    );
+    expect((await board.start(1)).kind).toEqual("default");
+    expect(speechCallback).toHaveBeenCalledTimes(1);
+    expect((await board.start(2)).kind).toEqual("default");
+    expect(createModule).toHaveBeenCalledTimes(1);
+    expect(speechCallback).toHaveBeenCalledTimes(2);
+  });
+
+  it("plays audio via the page's rings", async () => {
+    const { firmware, speechCallback } = createFirmware();
+    const board = new WorkerBoard(
+      firmware,
+      new FileSystem(),
+      notifications,
+      new SharedBoardState()
+    );
+    const rings = [new AudioRing(), new AudioRing(), new AudioRing()];
+    const setVolume = vi.fn();
+    board.audio.output = {
+      rings,
+      setVolume,
+      setPeriodUs: () => {},
+      setAmplitudeU10: () => {},
+    };
+    expect((await board.start(1)).kind).toEqual("default");
+    // Asked for more as the ring holds less than it wants.
+    expect(speechCallback).toHaveBeenCalledTimes(1);
+    const output = new Float32Array(4);
+    new AudioRing(rings[1].buffer).mixInto(output, 8000);
+    expect(Array.from(output)).toEqual([0.5, 0.5, 0.5, 0.5]);
+    board.audio.setVolume(128);
+    expect(setVolume).toHaveBeenCalledWith(128);
+  });
+});
@@ -0,0 +1,161 @@
+import { PolledClock, WallClock } from "./clock";
+import { Display } from "./display";
+import { FileSystem } from "./fs";
+import {
+  Firmware,
+  HeadlessBoard,
+  HeadlessNotifications,
+  HeadlessResult,
+  resultForError,
+} from "./headless";
+import { SharedBoardState } from "./shared-state";
+import { ModuleWrapper } from "./wasm";
+
+/**
+ * A display that publishes its frames to the main thread for rendering.
+ */
+class SharedDisplay extends Display {
+  private frame = new Uint8Array(25);
+
+  constructor(private shared: SharedBoardState) {
+    super(null);
+  }
+
+  protected scheduleRender() {
+    for (let y = 0; y < 5; ++y) {
+      for (let x = 0; x < 5; ++x) {
+        this.frame[y * 5 + x] = this.getPixel(x, y);
+      }
+    }
+    this.shared.writeFrame(this.frame);
+  }
+}
+
+/**
+ * The board used when the firmware runs in a worker.
+ *
+ * Input arrives via the shared state and everything other than the display
+ * is sent to the main thread as notifications.
+ *
+ * The blocking firmware calls wait rather than yielding to the event loop,
+ * so the clock's timeouts are run from there.
+ */
+export class WorkerBoard extends HeadlessBoard {
+  private runId: number = 0;
+  /**
+   * A module that stopped normally so can be started again.
+   */
+  private idleModule: ModuleWrapper | undefined;
+
+  constructor(
+    firmware: Firmware,
+    fs: FileSystem,
+    notifications: HeadlessNotifications,
+    private shared: SharedBoardState
+  ) {
+    super(
+      firmware,
+      fs,
+      notifications,
+      firmware.blocking ? new PolledClock() : new WallClock()
+    );
+    this.display = new SharedDisplay(shared);
+  }
+
+  /**
+   * Runs the firmware, including the REPL, until it's stopped.
+   */
+  async start(runId: number): Promise<Omit<HeadlessResult, "durationMs">> {
+    if (this.module) {
+      throw new Error("Already running!");
+    }
+    this.runId = runId;
+    const module = this.idleModule ?? (await this.createModule());
+    this.idleModule = undefined;
+    this.initializeCallbacks(module);
+    this.module = module;
+    let result: Omit<HeadlessResult, "durationMs">;
+    try {
+      await module.start(this.heapSize);
+      result = { kind: "default" };
+    } catch (e: any) {
+      result = resultForError(e);
+    }
+    // Before the snapshot is restored.
+    result.gc = this.lastGcStats = module.gcStats();
+    const reusable =
+      result.kind === "default" ||
+      ((result.kind === "panic" || result.kind === "reset") &&
+        module.restoreSnapshot());
+    if (reusable) {
+      this.idleModule = module;
+    } else {
+      try {
+        module.forceStop();
+      } catch (e: any) {
+        if (e.name !== "ExitStatus") {
+          result = { kind: "error", error: e };
+        }
+      }
+    }
+    // Called by the HAL for normal shutdown but not in error scenarios.
+    this.stopComponents();
+    this.module = undefined;
+    return result;
+  }
+
+  enableStats(enabled: boolean) {
+    if (enabled !== (this.stats !== undefined)) {
+      // So the next start creates a module with or without instrumentation.
+      this.idleModule = undefined;
+    }
+    super.enableStats(enabled);
+  }
+
+  /**
+   * Called by the blocking firmware when it would otherwise yield. Runs the
+   * timeouts that are due then waits for up to ms for input or the next
+   * timeout.
+   */
+  wait(ms: number) {
+    const clock = this.clock as PolledClock;
+    clock.runDueTimeouts();
+    if (ms > 0) {
+      this.shared.waitForInput(Math.min(ms, clock.msToNextTimeout()));
+      clock.runDueTimeouts();
+    }
+  }
+
+  readSerialInput(target: Uint8Array): number {
+    // Called each time the firmware processes events.
+    this.pollInput(true);
+    return super.readSerialInput(target);
+  }
+
+  initialize() {
+    super.initialize();
+    // Discard serial input left from stopping the previous run.
+    this.pollInput(false);
+    this.serialInput.clear();
+  }
+
+  private pollInput(acceptSerialInput: boolean) {
+    if (this.module && this.shared.isStopRequested(this.runId)) {
+      this.module.requestStop();
+    }
+    this.shared.drain(
+      (charCode) => {
+        if (acceptSerialInput) {
+          this.serialInput.push(charCode);
+        }
+      },
+      (id, value) => this.setValue(id, value),
+      (data) => {
+        // Packets sent while the radio is off are lost.
+        if (this.radio.state.enabled) {
+          this.radio.receive(data);
+        }
+      }
+    );
+  }
+}
@@ -0,0 +1,260 @@
+import { PanicError, ResetError } from "./errors";
+import { HeadlessNotifications } from "./headless";
+import { SharedBoardState } from "./shared-state";
+import { Stats } from "./stats";
+import { FirmwareModule, GcStats } from "./wasm";
+
+/**
+ * The main thread side of running the firmware in a worker (see worker.ts).
+ *
+ * Messages to the worker:
+ * - init: the shared state buffer and whether to load the blocking firmware.
+ * - flash: replaces the file system.
+ * - start: runs the firmware with the given heap size until stopped. Also
+ *   has the buffers of the page's audio rings, if it has an audio worklet.
+ * - stats: optionally enables or disables stats, replied to with stats
+ *   and GC stats.
+ *
+ * Messages from the worker are the notifications plus stopped, sent when
+ * a run ends, stats and audio, for the volume and tone the worker can't
+ * write to the rings. Serial, sensor and radio input and the display use
+ * the shared state.
+ *
+ * The blocking firmware doesn't yield to the worker's event loop, so while
+ * it runs it only sees input via the shared state and replies to stats
+ * when the run stops.
+ */
+export interface StatsReply {
+  stats: Stats | null;
+  gc: GcStats | null;
+}
+
+export interface WorkerHostDelegate extends HeadlessNotifications {
+  onFrame: (frame: Uint8Array) => void;
+  /**
+   * Text from data logging, otherwise the firmware's output as UTF-8.
+   */
+  onSerialOutput: (data: string | Uint8Array) => void;
+  onAudioSetting: (setting: AudioSetting, value: number) => void;
+}
+
+export type AudioSetting = "volume" | "periodUs" | "amplitudeU10";
+
+export class WorkerHost {
+  private worker: Worker;
+  private shared = new SharedBoardState();
+  private nextRunId = 1;
+  private runs = new Map<number, WorkerRun>();
+  // Input that didn't fit in the ring, sent when the worker catches up.
+  private pendingInput: Array<() => boolean> = [];
+  private frame = new Uint8Array(25);
+  private frameSequence = 0;
+  private animationFrame: number | undefined;
+  // Resolved in order as the worker replies.
+  private statsRequests: Array<(reply: StatsReply) => void> = [];
+
+  constructor(
+    url: string,
+    private delegate: WorkerHostDelegate,
+    blocking: boolean = false
+  ) {
+    this.worker = new Worker(url);
+    this.worker.addEventListener("message", this.onMessage);
+    this.worker.postMessage({
+      kind: "init",
+      buffer: this.shared.buffer,
+      blocking,
+    });
+  }
+
+  /**
+   * @param audioBuffers The buffers of the rings the worker plays audio via.
+   */
+  async createModule(
+    audioBuffers?: SharedArrayBuffer[]
+  ): Promise<FirmwareModule> {
+    return new WorkerModule(this, this.nextRunId++, audioBuffers);
+  }
+
+  flash(filesystem: Record<string, Uint8Array>) {
+    this.worker.postMessage({ kind: "flash", filesystem });
+  }
+
+  writeSerialInput(text: string) {
+    for (let i = 0; i < text.length; i++) {
+      const charCode = text.charCodeAt(i);
+      this.sendInput(() => this.shared.writeSerialInput(charCode));
+    }
+  }
+
+  setValue(id: string, value: any) {
+    this.sendInput(() => this.shared.setValue(id, value));
+  }
+
+  radioInput(data: Uint8Array) {
+    this.sendInput(() => this.shared.writeRadioInput(data));
+  }
+
+  stats(enabled: boolean | undefined): Promise<StatsReply> {
+    return new Promise((resolve) => {
+      this.statsRequests.push(resolve);
+      this.worker.postMessage({ kind: "stats", enabled });
+    });
+  }
+
+  /**
+   * Called by WorkerModule.
+   */
+  start(run: WorkerRun, heapSize: number) {
+    this.runs.set(run.runId, run);
+    this.worker.postMessage({
+      kind: "start",
+      runId: run.runId,
+      heapSize,
+      audioBuffers: run.audioBuffers,
+    });
+    this.renderFrames();
+  }
+
+  /**
+   * Called by WorkerModule.
+   */
+  requestStop(runId: number) {
+    this.shared.requestStop(runId);
+  }
+
+  private sendInput(send: () => boolean) {
+    // Preserve ordering if we're already waiting.
+    if (this.pendingInput.length > 0 || !send()) {
+      this.pendingInput.push(send);
+    }
+  }
+
+  private flushPendingInput() {
+    while (this.pendingInput.length > 0 && this.pendingInput[0]()) {
+      this.pendingInput.shift();
+    }
+  }
+
+  private renderFrames = () => {
+    this.flushPendingInput();
+    const sequence = this.shared.readFrame(this.frame, this.frameSequence);
+    if (sequence !== this.frameSequence) {
+      this.frameSequence = sequence;
+      this.delegate.onFrame(this.frame);
+    }
+    this.animationFrame =
+      this.runs.size > 0 ? requestAnimationFrame(this.renderFrames) : undefined;
+  };
+
+  private onMessage = (e: MessageEvent) => {
+    const { data } = e;
+    switch (data.kind) {
+      case "serial_output": {
+        this.delegate.onSerialOutput(data.data);
+        break;
+      }
+      case "radio_output": {
+        this.delegate.onRadioOutput(data.data);
+        break;
+      }
+      case "log_output": {
+        this.delegate.onLogOutput(data.data);
+        break;
+      }
+      case "log_delete": {
+        this.delegate.onLogDelete();
+        break;
+      }
+      case "state_change": {
+        this.delegate.onStateChange(data.change);
+        break;
+      }
+      case "audio": {
+        this.delegate.onAudioSetting(data.setting, data.value);
+        break;
+      }
+      case "stats": {
+        this.statsRequests.shift()?.({ stats: data.stats, gc: data.gc });
+        break;
+      }
+      case "stopped": {
+        const run = this.runs.get(data.runId);
+        this.runs.delete(data.runId);
+        if (this.animationFrame !== undefined && this.runs.size === 0) {
+          cancelAnimationFrame(this.animationFrame);
+          // Picks up the final frame without scheduling another.
+          this.renderFrames();
+        }
+        run?.stopped(data.stopKind, data.panicCode, data.error);
+        break;
+      }
+    }
+  };
+}
+
+interface WorkerRun {
+  runId: number;
+  audioBuffers?: SharedArrayBuffer[];
+  stopped(kind: string, panicCode?: number, error?: string): void;
+}
+
+class WorkerModule implements FirmwareModule, WorkerRun {
+  private resolve: (() => void) | undefined;
+  private reject: ((e: any) => void) | undefined;
+
+  constructor(
+    private host: WorkerHost,
+    public runId: number,
+    public audioBuffers?: SharedArrayBuffer[]
+  ) {}
+
+  /**
+   * Throws PanicError if MicroPython panics.
+   */
+  start(heapSize: number): Promise<void> {
+    return new Promise((resolve, reject) => {
+      this.resolve = resolve;
+      this.reject = reject;
+      this.host.start(this, heapSize);
+    });
+  }
+
+  stopped(kind: string, panicCode?: number, error?: string) {
+    switch (kind) {
+      case "panic": {
+        this.reject!(new PanicError(panicCode!));
+        break;
+      }
+      case "reset": {
+        this.reject!(new ResetError());
+        break;
+      }
+      case "error": {
+        this.reject!(new Error(error));
+        break;
+      }
+      default: {
+        this.resolve!();
+      }
+    }
+  }
+
+  requestStop(): void {
+    this.host.requestStop(this.runId);
+  }
+
+  forceStop(): void {
+    // The worker stops the module when it returns.
+  }
+
+  restoreSnapshot(): boolean {
+    // The worker restores its own module.
+    return false;
+  }
+
+  gcStats(): undefined {
+    // The worker reports them with its stats.
+    return undefined;
+  }
+}
@@ -24,6 +24,7 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
 #include "py/runtime.h"
 #include "drv_radio.h"
 #include "jshal.h"
@@ -35,52 +36,83 @@
 // 4 bytes time
 #define RADIO_PACKET_OVERHEAD (1 + 1 + 4)
 
-static uint8_t rx_buf_size = 0;
+// The receive queue is a ring of packets that JavaScript writes to directly,
+// see radio.ts. It starts with the index of the first packet and the number
+// of packets.
+#define RADIO_RX_READ (0)
+#define RADIO_RX_COUNT (1)
+#define RADIO_RX_HEADER (2)
+
+static size_t radio_buf_size = 0;
+static size_t rx_slot_size = 0;
+static uint8_t rx_queue_len = 0;
+static uint8_t max_payload = 0;
 
 void bitsflow_radio_enable(bitsflow_radio_config_t *config) {
     bitsflow_radio_disable();
 
-    uint8_t group = config->prefix0;
-    mp_js_radio_enable(group, config->max_payload, config->queue_len);
+    // The receive queue followed by space to assemble a packet to send.
+    max_payload = config->max_payload;
+    rx_queue_len = config->queue_len;
+    rx_slot_size = max_payload + RADIO_PACKET_OVERHEAD;
+    size_t rx_size = RADIO_RX_HEADER + rx_queue_len * rx_slot_size;
+    radio_buf_size = rx_size + max_payload;
+    uint8_t *buf = m_new(uint8_t, radio_buf_size);
+    buf[RADIO_RX_READ] = 0;
+    buf[RADIO_RX_COUNT] = 0;
+    MP_STATE_PORT(radio_buf) = buf;
 
-    // We have an rx buffer of size 1, the queue itself is in the JavaScript.
-    rx_buf_size = config->max_payload + RADIO_PACKET_OVERHEAD;
-    MP_STATE_PORT(radio_buf) = m_new(uint8_t, rx_buf_size);
+    uint8_t group = config->prefix0;
+    mp_js_radio_enable(group, config->max_payload, config->queue_len, config->base0, config->channel, config->data_rate, buf, rx_size);
 }
 
 void bitsflow_radio_disable(void) {
+    // JavaScript stops using the buffer first.
     mp_js_radio_disable();
 
     // free any old buffers
     if (MP_STATE_PORT(radio_buf) != NULL) {
-        m_del(uint8_t, MP_STATE_PORT(radio_buf), rx_buf_size);
+        m_del(uint8_t, MP_STATE_PORT(radio_buf), radio_buf_size);
         MP_STATE_PORT(radio_buf) = NULL;
-        rx_buf_size = 0;
+        radio_buf_size = 0;
     }
 }
 
-// Exposed so JavaScript can write directly into the max_payload sized buffer.
-uint8_t *bitsflow_radio_rx_buffer() {
-    return MP_STATE_PORT(radio_buf);
-}
-
 void bitsflow_radio_update_config(bitsflow_radio_config_t *config) {
     // This is not called if the max_payload or queue length change.
     // Instead we are disabled then enabled.
     uint8_t group = config->prefix0;
-    mp_js_radio_update_config(group, config->max_payload, config->queue_len);
+    mp_js_radio_update_config(group, config->max_payload, config->queue_len, config->base0, config->channel, config->data_rate);
 }
 
 // This assumes the radio is enabled.
 void bitsflow_radio_send(const void *buf, size_t len, const void *buf2, size_t len2) {
-    mp_js_radio_send(buf, len, buf2, len2);
+    // As on the hardware, packets are truncated to max_payload.
+    if (len2 == 0 && len <= max_payload) {
+        // JavaScript reads it in place.
+        mp_js_radio_send(buf, len);
+        return;
+    }
+    uint8_t *tx_buf = MP_STATE_PORT(radio_buf) + radio_buf_size - max_payload;
+    len = MIN(len, max_payload);
+    len2 = MIN(len2, max_payload - len);
+    memcpy(tx_buf, buf, len);
+    memcpy(tx_buf + len, buf2, len2);
+    mp_js_radio_send(tx_buf, len + len2);
 }
 
 const uint8_t *bitsflow_radio_peek(void) {
-    // This call writes to the rx buffer.
-    return mp_js_radio_peek();
+    const uint8_t *buf = MP_STATE_PORT(radio_buf);
+    if (buf[RADIO_RX_COUNT] == 0) {
+        return NULL;
+    }
+    return &buf[RADIO_RX_HEADER + buf[RADIO_RX_READ] * rx_slot_size];
 }
 
 void bitsflow_radio_pop(void) {
-    mp_js_radio_pop();
+    uint8_t *buf = MP_STATE_PORT(radio_buf);
+    if (buf[RADIO_RX_COUNT] > 0) {
+        buf[RADIO_RX_READ] = (buf[RADIO_RX_READ] + 1) % rx_queue_len;
+        buf[RADIO_RX_COUNT] -= 1;
+    }
 }
@@ -1,6 +1,7 @@
 from bitsflow import *
 
-# Unsupported in the simulator
+# Compiles but raises NotImplementedError when called in the simulator.
+# @micropython.native and @micropython.viper are unsupported on the device.
 @micropython.asm_thumb
 def asm_add(r0, r1):
     add(r0, r0, r1)
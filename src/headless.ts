@@ -0,0 +1,398 @@
+import { createWriteStream } from "fs";
+import { readFile } from "fs/promises";
+import { basename, extname } from "path";
+import { BytecodeCache } from "./board/bytecode-cache";
+import { DataLogStore } from "./board/data-log-store";
+import { FileSystem } from "./board/fs";
+import {
+  HeadlessBoard,
+  HeadlessResult,
+  HeadlessStopKind,
+} from "./board/headless";
+import { RadioNetwork } from "./board/radio-network";
+import { Stats } from "./board/stats";
+import { isValidHeapSize, maxHeapSize, minHeapSize } from "./board/wasm";
+import { loadFirmware } from "./node-firmware";
+
+const usage = `Usage: node headless.js [options] <main.py> [<module.py> ...]
+
+Runs main.py once on a simulated board with no UI.
+
+Options:
+  --timeout <ms>   Interrupt the program after this long (default 10000).
+  --input <text>   Write text to serial input when the program starts.
+  --script <file>  JSON array of timed inputs, each one of:
+                     {"time": 500, "id": "buttonA", "value": 1}
+                     {"time": 500, "serialInput": "text"}
+                     {"time": 500, "radioInput": [0, 1, 0, 1, 72, 105]}
+                   Times are in milliseconds from the start of the program.
+                   Add "board": <index> to only apply an entry to one board.
+  --virtual-time   Skip ahead when the program is idle, e.g. in sleep(), so
+                   it runs faster than real time. The timeout is unaffected.
+  --yield-budget <ms>
+                   How long a busy program runs before yielding to process
+                   timers and input (default 8).
+  --heap-size <bytes>
+                   The MicroPython heap size (default 65536, as on the
+                   device). GC stats are included in the JSON summary.
+  --json           Print a JSON summary rather than the serial output.
+  --stats          Count and time calls between the firmware and JavaScript.
+                   Included in the JSON summary, otherwise written to stderr.
+  --log-csv <file> Write the data log to this file as CSV. With more than one
+                   board the board index is added before the extension.
+
+Radio network options:
+  --boards <n>     Run the program on this many boards, which can hear each
+                   other's radio. Serial output lines are prefixed with the
+                   board index (default 1).
+  --radio-latency <ms>
+                   Delay before other boards receive a packet (default 0).
+  --radio-loss <p> Probability that a board misses a packet (default 0).
+  --radio-rssi <dBm>
+                   Signal strength of received packets.
+`;
+
+const exitCodes: Record<HeadlessStopKind, number> = {
+  default: 0,
+  error: 1,
+  panic: 2,
+  reset: 3,
+  timeout: 124,
+};
+
+interface ScriptEntry {
+  time: number;
+  id?: string;
+  value?: any;
+  serialInput?: string;
+  radioInput?: number[];
+  board?: number;
+}
+
+interface Options {
+  timeoutMs: number;
+  input?: string;
+  script?: string;
+  virtualTime: boolean;
+  yieldBudgetMs?: number;
+  heapSize?: number;
+  json: boolean;
+  stats: boolean;
+  logCsv?: string;
+  boards: number;
+  radioLatencyMs?: number;
+  radioLoss?: number;
+  radioRssi?: number;
+  files: string[];
+}
+
+const parseArgs = (args: string[]): Options => {
+  const options: Options = {
+    timeoutMs: 10_000,
+    virtualTime: false,
+    json: false,
+    stats: false,
+    boards: 1,
+    files: [],
+  };
+  for (let i = 0; i < args.length; ++i) {
+    const arg = args[i];
+    const value = () => {
+      if (i + 1 >= args.length) {
+        throw new Error(`Missing value for ${arg}`);
+      }
+      return args[++i];
+    };
+    switch (arg) {
+      case "--timeout": {
+        options.timeoutMs = parseInt(value(), 10);
+        if (!(options.timeoutMs > 0)) {
+          throw new Error("Invalid --timeout");
+        }
+        break;
+      }
+      case "--input": {
+        options.input = value();
+        break;
+      }
+      case "--script": {
+        options.script = value();
+        break;
+      }
+      case "--virtual-time": {
+        options.virtualTime = true;
+        break;
+      }
+      case "--yield-budget": {
+        options.yieldBudgetMs = parseInt(value(), 10);
+        if (!(options.yieldBudgetMs >= 0)) {
+          throw new Error("Invalid --yield-budget");
+        }
+        break;
+      }
+      case "--heap-size": {
+        options.heapSize = parseInt(value(), 10);
+        if (!isValidHeapSize(options.heapSize)) {
+          throw new Error(
+            `Invalid --heap-size, must be ${minHeapSize} to ${maxHeapSize}`
+          );
+        }
+        break;
+      }
+      case "--json": {
+        options.json = true;
+        break;
+      }
+      case "--stats": {
+        options.stats = true;
+        break;
+      }
+      case "--log-csv": {
+        options.logCsv = value();
+        break;
+      }
+      case "--boards": {
+        options.boards = parseInt(value(), 10);
+        if (!(options.boards > 0)) {
+          throw new Error("Invalid --boards");
+        }
+        break;
+      }
+      case "--radio-latency": {
+        options.radioLatencyMs = parseFloat(value());
+        if (!(options.radioLatencyMs >= 0)) {
+          throw new Error("Invalid --radio-latency");
+        }
+        break;
+      }
+      case "--radio-loss": {
+        options.radioLoss = parseFloat(value());
+        if (!(options.radioLoss >= 0 && options.radioLoss <= 1)) {
+          throw new Error("Invalid --radio-loss");
+        }
+        break;
+      }
+      case "--radio-rssi": {
+        options.radioRssi = parseInt(value(), 10);
+        if (!(options.radioRssi <= 0)) {
+          throw new Error("Invalid --radio-rssi");
+        }
+        break;
+      }
+      default: {
+        if (arg.startsWith("--")) {
+          throw new Error(`Unknown option ${arg}`);
+        }
+        options.files.push(arg);
+      }
+    }
+  }
+  if (options.files.length === 0) {
+    throw new Error("No program specified");
+  }
+  return options;
+};
+
+const main = async (args: string[]): Promise<number> => {
+  let options: Options;
+  try {
+    options = parseArgs(args);
+  } catch (e: any) {
+    process.stderr.write(`${e.message}\n\n${usage}`);
+    return 1;
+  }
+
+  const files: Record<string, Uint8Array> = {};
+  for (const [i, file] of options.files.entries()) {
+    // The first file is always run as main.py.
+    const name = i === 0 ? "main.py" : basename(file);
+    files[name] = await readFile(file);
+  }
+
+  const firmware = await loadFirmware(__dirname);
+  const network = new RadioNetwork({
+    virtualTime: options.virtualTime,
+    latencyMs: options.radioLatencyMs,
+    loss: options.radioLoss,
+    rssi: options.radioRssi,
+  });
+  const outputs: BoardOutput[] = [];
+  // The boards run the same files so only one compiles them.
+  const bytecodeCache = new BytecodeCache();
+  for (let i = 0; i < options.boards; ++i) {
+    const output = new BoardOutput(options.boards > 1 ? `${i}: ` : undefined);
+    const fs = new FileSystem(bytecodeCache);
+    for (const [name, data] of Object.entries(files)) {
+      fs.write(fs.create(name), data, true);
+    }
+    const board = network.addBoard(firmware, fs, {
+      onStateChange: () => {},
+      onSerialOutput: (data) => output.writeSerial(data, !options.json),
+      onRadioOutput: (data) => output.radioOutput.push(Array.from(data)),
+      onLogOutput: (data) => {
+        output.logOutput.push(data);
+        output.logStore.add(data);
+      },
+      onLogDelete: () => {
+        output.logOutput.length = 0;
+        output.logStore.clear();
+      },
+    });
+    board.enableStats(options.stats);
+    if (options.yieldBudgetMs !== undefined) {
+      board.yieldBudgetMs = options.yieldBudgetMs;
+    }
+    if (options.heapSize !== undefined) {
+      board.heapSize = options.heapSize;
+    }
+    if (options.input) {
+      board.writeSerialInput(options.input);
+    }
+    outputs.push(output);
+  }
+  if (options.script) {
+    const script: ScriptEntry[] = JSON.parse(
+      await readFile(options.script, { encoding: "utf-8" })
+    );
+    for (const entry of script) {
+      network.boards.forEach((board, i) => {
+        if (entry.board === undefined || entry.board === i) {
+          scheduleEntry(board, entry);
+        }
+      });
+    }
+  }
+
+  const results = await network.run(options.timeoutMs);
+  outputs.forEach((output) => output.flushSerial(!options.json));
+  if (options.logCsv) {
+    const file = options.logCsv;
+    await Promise.all(
+      outputs.map((output, i) =>
+        writeLogCsv(
+          options.boards > 1 ? insertBeforeExtension(file, `-${i}`) : file,
+          output.logStore
+        )
+      )
+    );
+  }
+  const stats = network.boards.map((board) => board.takeStats());
+  if (options.json) {
+    const summaries = results.map((result, i) =>
+      summarize(result, outputs[i], stats[i])
+    );
+    process.stdout.write(
+      JSON.stringify(options.boards > 1 ? summaries : summaries[0]) + "\n"
+    );
+  } else {
+    results.forEach((result, i) => {
+      if (result.kind !== "default") {
+        const detail =
+          result.kind === "panic"
+            ? ` ${result.panicCode}`
+            : result.kind === "error"
+            ? ` ${result.error}`
+            : "";
+        const board = options.boards > 1 ? ` (board ${i})` : "";
+        process.stderr.write(`\nStopped${board}: ${result.kind}${detail}\n`);
+      }
+    });
+    stats.forEach((boardStats, i) => {
+      if (boardStats) {
+        const board = options.boards > 1 ? ` (board ${i})` : "";
+        process.stderr.write(
+          `\nStats${board}: ${JSON.stringify(boardStats, null, 2)}\n`
+        );
+      }
+    });
+  }
+  // The first board that didn't finish normally determines the exit code.
+  const stopped = results.find((result) => result.kind !== "default");
+  return exitCodes[stopped?.kind ?? "default"];
+};
+
+const scheduleEntry = (board: HeadlessBoard, entry: ScriptEntry) =>
+  board.schedule(entry.time, () => {
+    if (entry.id !== undefined) {
+      board.setValue(entry.id, entry.value);
+    }
+    if (entry.serialInput !== undefined) {
+      board.writeSerialInput(entry.serialInput);
+    }
+    // Like real hardware, packets sent while the radio is off are lost.
+    if (entry.radioInput !== undefined && board.radio.state.enabled) {
+      board.radio.receive(new Uint8Array(entry.radioInput));
+    }
+  });
+
+const writeLogCsv = (file: string, store: DataLogStore) =>
+  new Promise<void>((resolve, reject) => {
+    const stream = createWriteStream(file);
+    stream.on("error", reject);
+    for (const chunk of store.csv()) {
+      stream.write(chunk);
+    }
+    stream.end(resolve);
+  });
+
+const insertBeforeExtension = (file: string, text: string) => {
+  const extension = extname(file);
+  return file.slice(0, file.length - extension.length) + text + extension;
+};
+
+/**
+ * Collects a board's output. With more than one board serial output is
+ * written a line at a time with a prefix so it's clear which board it's from.
+ */
+class BoardOutput {
+  serialOutput: string[] = [];
+  radioOutput: number[][] = [];
+  logOutput: object[] = [];
+  logStore = new DataLogStore();
+  private partialLine: string = "";
+
+  constructor(private prefix: string | undefined) {}
+
+  writeSerial(data: string, toStdout: boolean) {
+    this.serialOutput.push(data);
+    if (!toStdout) {
+      return;
+    }
+    if (this.prefix === undefined) {
+      process.stdout.write(data);
+      return;
+    }
+    const lines = (this.partialLine + data).split("\n");
+    this.partialLine = lines.pop()!;
+    for (const line of lines) {
+      process.stdout.write(`${this.prefix}${line}\n`);
+    }
+  }
+
+  flushSerial(toStdout: boolean) {
+    if (toStdout && this.partialLine) {
+      process.stdout.write(`${this.prefix}${this.partialLine}\n`);
+    }
+    this.partialLine = "";
+  }
+}
+
+const summarize = (
+  result: HeadlessResult,
+  output: BoardOutput,
+  stats: Stats | undefined
+) => ({
+  kind: result.kind,
+  panicCode: result.panicCode,
+  error: result.error?.toString(),
+  durationMs: Math.round(result.durationMs),
+  serialOutput: output.serialOutput.join(""),
+  radioOutput: output.radioOutput,
+  logOutput: output.logOutput,
+  gc: result.gc,
+  stats,
+});
+
+main(process.argv.slice(2)).then((code) => {
+  process.exitCode = code;
+});
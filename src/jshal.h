@@ -30,16 +30,24 @@ void mp_js_hal_deinit(void);
 uint32_t mp_js_rng_generate_random_word();
 
 uint32_t mp_js_hal_ticks_ms(void);
+bool mp_js_hal_virtual_time(void);
+bool mp_js_hal_skip_ms(uint32_t max_ms);
+uint32_t mp_js_hal_yield_budget_ms(void);
+void mp_js_hal_wait(uint32_t ms);
 void mp_js_hal_stdout_tx_strn(const char *ptr, size_t len);
-int mp_js_hal_stdin_pop_char(void);
+size_t mp_js_hal_stdin_read(uint8_t *buf, size_t len);
 
 int mp_js_hal_filesystem_find(const char *name, size_t len);
 int mp_js_hal_filesystem_create(const char *name, size_t len);
 int mp_js_hal_filesystem_name(int idx, char *buf);
 int mp_js_hal_filesystem_size(int idx);
 void mp_js_hal_filesystem_remove(int idx);
-int mp_js_hal_filesystem_readbyte(int idx, size_t offset);
+int mp_js_hal_filesystem_read(int idx, size_t offset, uint8_t *buf, size_t len);
 bool mp_js_hal_filesystem_write(int idx, const char *buf, size_t len);
+int mp_js_hal_filesystem_bytecode_size(int idx);
+int mp_js_hal_filesystem_bytecode_read(int idx, size_t offset, uint8_t *buf, size_t len);
+void mp_js_hal_filesystem_bytecode_write(int idx, size_t offset, const uint8_t *buf, size_t len);
+void mp_js_hal_filesystem_bytecode_end(int idx);
 
 void mp_js_hal_panic(int code);
 void mp_js_hal_reset(void);
@@ -55,6 +63,7 @@ int mp_js_hal_pin_set_analog_period_us(int pin, int period);
 
 int mp_js_hal_display_get_pixel(int x, int y);
 void mp_js_hal_display_set_pixel(int x, int y, int value);
+void mp_js_hal_display_set_frame(const uint8_t *frame);
 void mp_js_hal_display_clear(void);
 int mp_js_hal_display_read_light_level(void);
 
@@ -77,20 +86,17 @@ void mp_js_hal_audio_speech_init(uint32_t sample_rate);
 void mp_js_hal_audio_speech_write_data(const uint8_t *buf, size_t num_samples);
 void mp_js_hal_audio_period_us(int period);
 void mp_js_hal_audio_amplitude_u10(int amplitude);
-void mp_js_hal_audio_play_expression(const char *name);
+void mp_js_hal_audio_play_expression(float *buf, uint32_t sample_rate);
 void mp_js_hal_audio_stop_expression(void);
-bool mp_js_hal_audio_is_expression_active(void);
 
 void mp_js_hal_microphone_init(void);
 void mp_js_hal_microphone_set_threshold(int kind, int value);
 int mp_js_hal_microphone_get_level(void);
 
-void mp_js_radio_enable(uint8_t group, uint8_t max_payload, uint8_t queue);
+void mp_js_radio_enable(uint8_t group, uint8_t max_payload, uint8_t queue, uint32_t address, uint8_t channel, uint8_t data_rate, uint8_t *rx_queue, size_t rx_size);
 void mp_js_radio_disable(void);
-void mp_js_radio_update_config(uint8_t group, uint8_t max_payload, uint8_t queue);
-void mp_js_radio_send(const void *buf, size_t len, const void *buf2, size_t len2);
-uint8_t *mp_js_radio_peek(void);
-void mp_js_radio_pop(void);
+void mp_js_radio_update_config(uint8_t group, uint8_t max_payload, uint8_t queue, uint32_t address, uint8_t channel, uint8_t data_rate);
+void mp_js_radio_send(const void *buf, size_t len);
 
 void mp_js_hal_log_delete(bool full_erase);
 void mp_js_hal_log_set_mirroring(bool serial);
@@ -98,3 +104,4 @@ void mp_js_hal_log_set_timestamp(int period);
 int mp_js_hal_log_begin_row(void);
 int mp_js_hal_log_end_row(void);
 int mp_js_hal_log_data(const char *key, const char *value);
+int mp_js_hal_log_add_row(const bitsflow_hal_log_value_t *values, size_t n);
@@ -44,15 +44,39 @@ mergeInto(LibraryManager.library, {
     return Module.board.ticksMilliseconds();
   },
 
-  mp_js_hal_stdin_pop_char: function () {
-    return Module.board.readSerialInput();
+  mp_js_hal_virtual_time: function () {
+    return Module.board.clock.virtual;
+  },
+
+  mp_js_hal_skip_ms: function (/** @type {number} */ max_ms) {
+    return Module.board.skipMilliseconds(max_ms);
+  },
+
+  mp_js_hal_yield_budget_ms: function () {
+    return Module.board.yieldBudgetMs;
+  },
+
+  mp_js_hal_wait: function (/** @type {number} */ ms) {
+    // Only the blocking build calls this and it only runs in a worker.
+    // @ts-expect-error
+    Module.board.wait(ms);
+  },
+
+  mp_js_hal_stdin_read: function (
+    /** @type {number} */ buf,
+    /** @type {number} */ len
+  ) {
+    return Module.board.readSerialInput(
+      Module.HEAPU8.subarray(buf, buf + len)
+    );
   },
 
   mp_js_hal_stdout_tx_strn: function (
     /** @type {number} */ ptr,
     /** @type {number} */ len
   ) {
-    Module.board.writeSerialOutput(UTF8ToString(ptr, len));
+    // A view that's only valid for the duration of the call.
+    Module.board.writeSerialOutput(Module.HEAPU8.subarray(ptr, ptr + len));
   },
 
   mp_js_hal_filesystem_find: function (
@@ -91,11 +115,13 @@ mergeInto(LibraryManager.library, {
     return Module.fs.remove(idx);
   },
 
-  mp_js_hal_filesystem_readbyte: function (
+  mp_js_hal_filesystem_read: function (
     /** @type {number} */ idx,
-    /** @type {number} */ offset
+    /** @type {number} */ offset,
+    /** @type {number} */ buf,
+    /** @type {number} */ len
   ) {
-    return Module.fs.readbyte(idx, offset);
+    return Module.fs.read(idx, offset, Module.HEAPU8.subarray(buf, buf + len));
   },
 
   mp_js_hal_filesystem_write: function (
@@ -107,6 +133,37 @@ mergeInto(LibraryManager.library, {
     return Module.fs.write(idx, data);
   },
 
+  mp_js_hal_filesystem_bytecode_size: function (/** @type {number} */ idx) {
+    const bytecode = Module.fs.bytecode(idx);
+    return bytecode ? bytecode.length : -1;
+  },
+
+  mp_js_hal_filesystem_bytecode_read: function (
+    /** @type {number} */ idx,
+    /** @type {number} */ offset,
+    /** @type {number} */ buf,
+    /** @type {number} */ len
+  ) {
+    return Module.fs.readBytecode(
+      idx,
+      offset,
+      Module.HEAPU8.subarray(buf, buf + len)
+    );
+  },
+
+  mp_js_hal_filesystem_bytecode_write: function (
+    /** @type {number} */ idx,
+    /** @type {number} */ offset,
+    /** @type {number} */ buf,
+    /** @type {number} */ len
+  ) {
+    Module.fs.writeBytecode(offset, Module.HEAPU8.slice(buf, buf + len));
+  },
+
+  mp_js_hal_filesystem_bytecode_end: function (/** @type {number} */ idx) {
+    Module.fs.endBytecode(idx);
+  },
+
   mp_js_hal_reset: function () {
     Module.board.throwReset();
   },
@@ -157,6 +214,10 @@ mergeInto(LibraryManager.library, {
     Module.board.display.setPixel(x, y, value);
   },
 
+  mp_js_hal_display_set_frame: function (/** @type {number} */ frame) {
+    Module.board.display.setFrame(Module.HEAPU8.subarray(frame, frame + 25));
+  },
+
   mp_js_hal_display_clear: function () {
     Module.board.display.clear();
   },
@@ -287,24 +348,44 @@ mergeInto(LibraryManager.library, {
     return Module.board.microphone.soundLevel.value;
   },
 
-  mp_js_hal_audio_play_expression: function (/** @type {any} */ expr) {
-    return Module.board.audio.playSoundExpression(UTF8ToString(expr));
+  mp_js_hal_audio_play_expression: function (
+    /** @type {number} */ buf,
+    /** @type {number} */ sample_rate
+  ) {
+    // The firmware synthesizes each buffer of the expression, see
+    // sound_synth.c.
+    const start = buf >> 2;
+    Module.board.audio.playSoundExpression(sample_rate, () =>
+      Module.HEAPF32.subarray(start, start + Module._sound_synth_pull())
+    );
   },
 
   mp_js_hal_audio_stop_expression: function () {
     return Module.board.audio.stopSoundExpression();
   },
 
-  mp_js_hal_audio_is_expression_active: function () {
-    return Module.board.audio.isSoundExpressionActive();
-  },
-
   mp_js_radio_enable: function (
     /** @type {number} */ group,
     /** @type {number} */ max_payload,
-    /** @type {number} */ queue
+    /** @type {number} */ queue,
+    /** @type {number} */ address,
+    /** @type {number} */ channel,
+    /** @type {number} */ data_rate,
+    /** @type {number} */ rx_queue,
+    /** @type {number} */ rx_size
   ) {
-    Module.board.radio.enable({ group, maxPayload: max_payload, queue });
+    // Packets are received straight into the queue in the firmware's memory.
+    Module.board.radio.enable(
+      {
+        group,
+        maxPayload: max_payload,
+        queue,
+        address: address >>> 0,
+        channel,
+        dataRate: data_rate,
+      },
+      Module.HEAPU8.subarray(rx_queue, rx_queue + rx_size)
+    );
   },
 
   mp_js_radio_disable: function () {
@@ -314,33 +395,27 @@ mergeInto(LibraryManager.library, {
   mp_js_radio_update_config: function (
     /** @type {number} */ group,
     /** @type {number} */ max_payload,
-    /** @type {number} */ queue
+    /** @type {number} */ queue,
+    /** @type {number} */ address,
+    /** @type {number} */ channel,
+    /** @type {number} */ data_rate
   ) {
-    Module.board.radio.updateConfig({ group, maxPayload: max_payload, queue });
+    Module.board.radio.updateConfig({
+      group,
+      maxPayload: max_payload,
+      queue,
+      address: address >>> 0,
+      channel,
+      dataRate: data_rate,
+    });
   },
 
   mp_js_radio_send: function (
     /** @type {number} */ buf,
-    /** @type {number} */ len,
-    /** @type {number} */ buf2,
-    /** @type {number} */ len2
+    /** @type {number} */ len
   ) {
-    const data = new Uint8Array(len + len2);
-    data.set(Module.HEAPU8.slice(buf, buf + len));
-    data.set(Module.HEAPU8.slice(buf2, buf2 + len2), len);
-    Module.board.radio.send(data);
-  },
-
-  mp_js_radio_peek: function () {
-    const packet = Module.board.radio.peek();
-    if (packet) {
-      return Module.board.writeRadioRxBuffer(packet);
-    }
-    return null;
-  },
-
-  mp_js_radio_pop: function () {
-    Module.board.radio.pop();
+    // A view that's only valid for the duration of the call.
+    Module.board.radio.send(Module.HEAPU8.subarray(buf, buf + len));
   },
 
   mp_js_hal_log_delete: function (/** @type {boolean} */ full_erase) {
@@ -373,4 +448,33 @@ mergeInto(LibraryManager.library, {
       UTF8ToString(value)
     );
   },
+
+  mp_js_hal_log_add_row: function (
+    /** @type {number} */ values,
+    /** @type {number} */ n
+  ) {
+    const dataLogging = Module.board.dataLogging;
+    const heap = Module.HEAP32;
+    dataLogging.beginRow();
+    for (let i = 0; i < n; i++) {
+      // See bitsflow_hal_log_value_t.
+      const base = (values >> 2) + i * 6;
+      const keyQstr = heap[base];
+      let key = keyQstr ? dataLogging.qstrKeys.get(keyQstr) : undefined;
+      if (key === undefined) {
+        key = UTF8ToString(heap[base + 1], heap[base + 2]);
+        if (keyQstr) {
+          dataLogging.qstrKeys.set(keyQstr, key);
+        }
+      }
+      // BITSFLOW_HAL_LOG_VALUE_INT or BITSFLOW_HAL_LOG_VALUE_STR. Integers
+      // are formatted now rather than on export as log_output sends strings.
+      const value =
+        heap[base + 3] === 0
+          ? heap[base + 4].toString()
+          : UTF8ToString(heap[base + 5], heap[base + 4]);
+      dataLogging.logData(key, value);
+    }
+    return dataLogging.endRow();
+  },
 });
@@ -26,10 +26,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <emscripten.h>
 
 #include "py/gc.h"
 #include "py/compile.h"
+#include "py/emitglue.h"
 #include "py/mperrno.h"
 #include "py/mphal.h"
 #include "py/runtime.h"
@@ -40,11 +43,13 @@
 #include "drv_display.h"
 #include "modbitsflow.h"
 #include "bitsflowhal_js.h"
+#include "jshal.h"
 
 // Set to true if a soft-timer callback can use mp_sched_exception to propagate out an exception.
 bool bitsflow_outer_nlr_will_handle_soft_timer_exceptions;
 
 void bitsflow_pyexec_file(const char *filename);
+mp_raw_code_t *bitsflow_fs_load_raw_code(const char *filename);
 
 bool stop_requested = 0;
 
@@ -56,9 +61,70 @@ void mp_js_force_stop(void) {
     emscripten_force_exit(0);
 }
 
+// The end of the memory in use, for JavaScript to snapshot.
+uintptr_t mp_js_heap_top(void) {
+    return (uintptr_t)sbrk(0);
+}
+
+// GC telemetry for the current run, or the last one once it has finished.
+// Read by JavaScript, see GcStats in board/wasm.ts, so all doubles.
+typedef struct _mp_js_gc_stats_t {
+    double heap_size;
+    double collections;
+    double pause_total_ms;
+    double pause_max_ms;
+    double bytes_allocated;
+    double used;
+    double peak_used;
+    double free;
+    double max_free_block;
+} mp_js_gc_stats_t;
+
+STATIC mp_js_gc_stats_t gc_stats;
+// Whether the GC heap exists so we can update the stats from it.
+STATIC bool gc_stats_live;
+// Allocations up to the last collection, which resets the GC's count.
+STATIC double gc_stats_allocated_before_collect;
+
+STATIC void gc_stats_init(size_t heap_size) {
+    memset(&gc_stats, 0, sizeof(gc_stats));
+    gc_stats.heap_size = heap_size;
+    gc_stats_allocated_before_collect = 0;
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) = 0;
+    #endif
+    gc_stats_live = true;
+}
+
+STATIC void gc_stats_update(void) {
+    gc_info_t info;
+    gc_info(&info);
+    gc_stats.used = info.used;
+    gc_stats.free = info.free;
+    gc_stats.max_free_block = info.max_free * MICROPY_BYTES_PER_GC_BLOCK;
+    if (info.used > gc_stats.peak_used) {
+        gc_stats.peak_used = info.used;
+    }
+    gc_stats.bytes_allocated = gc_stats_allocated_before_collect;
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    gc_stats.bytes_allocated += (double)MP_STATE_MEM(gc_alloc_amount) * MICROPY_BYTES_PER_GC_BLOCK;
+    #endif
+}
+
+mp_js_gc_stats_t *mp_js_gc_stats(void) {
+    if (gc_stats_live) {
+        gc_stats_update();
+    }
+    return &gc_stats;
+}
+
 // Main entrypoint called from JavaScript.
 // Calling mp_js_request_stop allows Ctrl-D to exit, otherwise Ctrl-D does a soft reset.
-// As we use asyncify you can await this call.
+// Calling it before this function runs main.py once without entering the REPL.
+// As we use asyncify you can await this call. The blocking build (see
+// BITSFLOW_BLOCKING) returns only when stopped.
+// If it returns normally then the state is as it was before the first call, so
+// it can be called again rather than creating a new instance.
 void mp_js_main(int heap_size) {
     while (!stop_requested) {
         bitsflow_hal_init();
@@ -68,6 +134,7 @@ void mp_js_main(int heap_size) {
         #if MICROPY_ENABLE_GC
         char *heap = (char *)malloc(heap_size * sizeof(char));
         gc_init(heap, heap + heap_size);
+        gc_stats_init(heap_size);
         #endif
 
         #if MICROPY_ENABLE_PYSTACK
@@ -79,7 +146,8 @@ void mp_js_main(int heap_size) {
 
         if (pyexec_mode_kind == PYEXEC_MODE_FRIENDLY_REPL) {
             const char *main_py = "main.py";
-            if (mp_import_stat(main_py) == MP_IMPORT_STAT_FILE) {
+            // Not mp_import_stat, which hides .py files. See bitsflowfs.c.
+            if (mp_js_hal_filesystem_find(main_py, strlen(main_py)) >= 0) {
                 // exec("main.py")
                 bitsflow_pyexec_file(main_py);
             } else {
@@ -88,7 +156,9 @@ void mp_js_main(int heap_size) {
             }
         }
 
-        for (;;) {
+        // A stop requested before or during main.py skips the REPL.
+        // The headless runner relies on this to run main.py exactly once.
+        while (!stop_requested) {
             if (pyexec_mode_kind == PYEXEC_MODE_RAW_REPL) {
                 if (pyexec_raw_repl() != 0) {
                     break;
@@ -103,10 +173,16 @@ void mp_js_main(int heap_size) {
         mp_printf(MP_PYTHON_PRINTER, "MPY: soft reboot\n");
         //bitsflow_soft_timer_deinit();
         bitsflow_hal_deinit();
+        gc_stats_update();
+        gc_stats_live = false;
         gc_sweep_all();
         mp_deinit();
         free(heap);
     }
+
+    // Ready for the next call.
+    stop_requested = 0;
+    pyexec_mode_kind = PYEXEC_MODE_FRIENDLY_REPL;
 }
 
 STATIC void bitsflow_display_exception(mp_obj_t exc_in) {
@@ -148,11 +224,9 @@ STATIC void bitsflow_display_exception(mp_obj_t exc_in) {
 void bitsflow_pyexec_file(const char *filename) {
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
-        // Parse and comple the file.
-        mp_lexer_t *lex = mp_lexer_new_from_file(filename);
-        qstr source_name = lex->source_name;
-        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
-        mp_obj_t module_fun = mp_compile(&parse_tree, source_name, false);
+        // Load the compiled file, compiling it if it's not cached.
+        mp_raw_code_t *raw_code = bitsflow_fs_load_raw_code(filename);
+        mp_obj_t module_fun = mp_make_function_from_raw_code(raw_code, MP_OBJ_NULL, MP_OBJ_NULL);
 
         // Execute the code.
         mp_hal_set_interrupt_char(CHAR_CTRL_C); // allow ctrl-C to interrupt us
@@ -188,8 +262,24 @@ STATIC void gc_scan_func(void *begin, void *end) {
 }
 
 void gc_collect(void) {
+    // Also catches the peak as a collection is usually due to a full heap.
+    gc_stats_update();
+    gc_stats_allocated_before_collect = gc_stats.bytes_allocated;
+    double start = emscripten_get_now();
+
     gc_collect_start();
     emscripten_scan_stack(gc_scan_func);
+    // Scanning the Wasm locals needs asyncify. The blocking build is instead
+    // linked with --spill-pointers so pointers are on the stack too.
+    #if !BITSFLOW_BLOCKING
     emscripten_scan_registers(gc_scan_func);
+    #endif
     gc_collect_end();
+
+    double pause_ms = emscripten_get_now() - start;
+    gc_stats.collections++;
+    gc_stats.pause_total_ms += pause_ms;
+    if (pause_ms > gc_stats.pause_max_ms) {
+        gc_stats.pause_max_ms = pause_ms;
+    }
 }
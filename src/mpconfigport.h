@@ -35,9 +35,14 @@
 #define MICROPY_ALLOC_PATH_MAX                  (128)
 
 // MicroPython emitters
+// As on the device, so asm_thumb functions compile, but they can't run (see
+// MICROPY_MAKE_POINTER_CALLABLE). The device has no native emitter, so
+// @micropython.native and @micropython.viper are a SyntaxError on both and
+// we don't add one for WebAssembly.
 #define MICROPY_EMIT_INLINE_THUMB               (1)
 
 // Python internal features
+// How often the VM checks whether to yield. See bitsflow_hal_background_processing.
 #define MICROPY_VM_HOOK_COUNT                   (256)
 #define MICROPY_VM_HOOK_INIT \
     static unsigned int vm_hook_divisor = MICROPY_VM_HOOK_COUNT;
@@ -61,6 +66,11 @@
 #define MICROPY_MODULE_BUILTIN_INIT             (1)
 #define MICROPY_MODULE_WEAK_LINKS               (1)
 #define MICROPY_MODULE_FROZEN_MPY               (1)
+// For the bytecode cache, which imports .py files as compiled code. See
+// bitsflow_fs_load_raw_code.
+#define MICROPY_PERSISTENT_CODE_LOAD            (1)
+#define MICROPY_PERSISTENT_CODE_SAVE            (1)
+#define MICROPY_HAS_FILE_READER                 (1)
 #define MICROPY_QSTR_EXTRA_POOL                 mp_qstr_frozen_const_pool
 #define MICROPY_USE_INTERNAL_ERRNO              (1)
 #define MICROPY_USE_INTERNAL_PRINTF             (0)
@@ -76,6 +86,10 @@
 #define MICROPY_PY_BUILTINS_HELP_TEXT           bitsflow_help_text
 #define MICROPY_PY_BUILTINS_HELP_MODULES        (1)
 #define MICROPY_PY___FILE__                     (0)
+// Imports load x.py via a virtual x.mpy (see bitsflowfs.c) and MicroPython
+// names the module's __file__ after that, so keep it off under its newer name
+// too. Tracebacks still name x.py.
+#define MICROPY_MODULE___FILE__                 (0)
 #define MICROPY_PY_MICROPYTHON_MEM_INFO         (1)
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT      (1)
 #define MICROPY_PY_IO                           (0)
@@ -102,6 +116,13 @@
     { MP_ROM_QSTR(MP_QSTR_open), MP_ROM_PTR(&mp_builtin_open_obj) },
 #endif
 
+// Serial input is copied from JavaScript into a ring of this size, in as few
+// calls as it takes to fill it, so larger sizes paste large programs into
+// the REPL faster. At most 65535.
+#ifndef BITSFLOW_STDIN_BUFFER_SIZE
+#define BITSFLOW_STDIN_BUFFER_SIZE (8192)
+#endif
+
 #define BITSFLOW_RELEASE "0.0.1"
 #define BITSFLOW_BOARD_NAME "bitsflow"
 #define MICROPY_HW_BOARD_NAME BITSFLOW_BOARD_NAME " v" BITSFLOW_RELEASE
@@ -142,6 +163,7 @@ extern const struct _mp_obj_module_t utime_module;
     const char *readline_hist[8]; \
     void *display_data; \
     uint8_t *radio_buf; \
+    struct _sound_synth_effect_t *sound_synth_effects; \
     void *audio_source; \
     void *speech_data; \
     struct _music_data_t *music_data; \
@@ -4,7 +4,7 @@
 #include "bitsflowhal_js.h"
 #include "jshal.h"
 
-static uint8_t stdin_ringbuf_array[260];
+static uint8_t stdin_ringbuf_array[BITSFLOW_STDIN_BUFFER_SIZE];
 ringbuf_t stdin_ringbuf = {stdin_ringbuf_array, sizeof(stdin_ringbuf_array), 0, 0};
 
 uintptr_t mp_hal_stdio_poll(uintptr_t poll_flags) {
@@ -26,7 +26,10 @@ int mp_hal_stdin_rx_chr(void) {
             return c;
         }
         mp_handle_pending(true);
-        bitsflow_hal_idle();
+        // Pasted input is usually waiting in JavaScript already.
+        if (!bitsflow_hal_stdin_refill()) {
+            bitsflow_hal_idle();
+        }
     }
 }
 
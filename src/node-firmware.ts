@@ -0,0 +1,20 @@
+import { readFile } from "fs/promises";
+import { join } from "path";
+import { Firmware } from "./board/headless";
+
+/**
+ * Loads the firmware that sits alongside the script in the build directory.
+ *
+ * @param blocking Load firmware-blocking, from make blocking, instead.
+ */
+export const loadFirmware = async (
+  dir: string,
+  blocking: boolean = false
+): Promise<Firmware> => {
+  const name = blocking ? "firmware-blocking" : "firmware";
+  const wasm = await WebAssembly.compile(
+    await readFile(join(dir, `${name}.wasm`))
+  );
+  const createModule = require(join(dir, `${name}.js`));
+  return { createModule, wasm, blocking };
+};
@@ -15,6 +15,17 @@ declare global {
   }
 }
 
+// Opt in to running the firmware in a worker with ?worker=1, or
+// ?worker=blocking for the firmware built without asyncify.
+// SharedArrayBuffer needs the page to be cross-origin isolated.
+const workerParam = new URLSearchParams(window.location.search).get("worker");
+const useWorker =
+  (workerParam === "1" || workerParam === "blocking") &&
+  self.crossOriginIsolated;
+
 const fs = new FileSystem();
-const board = createBoard(new Notifications(window.parent), fs);
+const board = createBoard(new Notifications(window.parent), fs, {
+  workerUrl: useWorker ? "./build/worker.js" : undefined,
+  blocking: workerParam === "blocking",
+});
 window.addEventListener("message", createMessageListener(board));
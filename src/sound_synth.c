@@ -0,0 +1,624 @@
+/*
+ * Sound expression synthesizer for the simulator.
+ *
+ * Adapted from Microsoft MakeCode's conversion of the CODAL synthesizer.
+ * Copyright (c) Microsoft Corporation
+ * SPDX-License-Identifier: MIT
+ *
+ * https://github.com/microsoft/pxt/blob/f2476687fe636ec7cbf47e96b22c7acec1978461/pxtsim/sound/soundEmojiSynthesizer.ts
+ * https://github.com/microsoft/pxt/blob/676b0eeaf419386fc50b251ec60a73d940941d80/pxtsim/sound/soundSynthesizerEffects.ts
+ * https://github.com/microsoft/pxt/blob/41530725a3d70f67ee4e501066c701e7a0c20ff6/pxtsim/sound/soundexpression.ts
+ *
+ * The arithmetic is in doubles, as in the TypeScript, so the output matches.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "py/runtime.h"
+#include "jshal.h"
+#include "sound_synth.h"
+
+// https://github.com/lancaster-university/codal-bitsflow-v2/blob/master/inc/SoundEmojiSynthesizer.h#L30
+#define TONE_WIDTH (1024)
+#define TONE_EFFECTS (3)
+#define SAMPLE_RANGE (1023)
+
+// 72 characters of sound data comma separated.
+#define CHARS_PER_EFFECT (72)
+
+typedef struct _sound_synth_progression_t {
+    const double *interval;
+    int length;
+} sound_synth_progression_t;
+
+struct _sound_synth_tone_effect_t;
+typedef void (*sound_synth_effect_fn_t)(struct _sound_synth_tone_effect_t *context);
+typedef double (*sound_synth_tone_print_fn_t)(double position);
+
+typedef struct _sound_synth_tone_effect_t {
+    sound_synth_effect_fn_t effect;
+    int step;
+    int steps;
+    double parameter[2];
+    const sound_synth_progression_t *parameter_p;
+} sound_synth_tone_effect_t;
+
+typedef struct _sound_synth_effect_t {
+    double frequency;
+    double volume;
+    int duration;
+    sound_synth_tone_print_fn_t tone_print;
+    sound_synth_tone_effect_t effects[TONE_EFFECTS];
+} sound_synth_effect_t;
+
+// The effects being played are in MP_STATE_PORT(sound_synth_effects).
+static size_t effect_count;
+static int effect_pointer = -1;
+static int samples_per_step[TONE_EFFECTS];
+static int samples_to_write;
+static int samples_written;
+static double frequency;
+static double volume;
+static double position;
+static bool active;
+
+static float buffer[SOUND_SYNTH_BUFFER_SIZE];
+
+static sound_synth_effect_t *current_effect(void) {
+    if (effect_pointer < 0 || (size_t)effect_pointer >= effect_count) {
+        return NULL;
+    }
+    return &MP_STATE_PORT(sound_synth_effects)[effect_pointer];
+}
+
+/******************************************************************************/
+// Tone prints.
+
+// Adapted from lancaster-university/codal-core
+// https://github.com/lancaster-university/codal-core/blob/master/source/streams/Synthesizer.cpp#L54
+static const uint16_t sine_tone[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2,
+    2, 2, 3, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9,
+    9, 10, 11, 11, 12, 13, 13, 14, 15, 16, 16, 17, 18, 19, 20, 21,
+    22, 22, 23, 24, 25, 26, 27, 28, 29, 30, 32, 33, 34, 35, 36, 37,
+    38, 40, 41, 42, 43, 45, 46, 47, 49, 50, 51, 53, 54, 56, 57, 58,
+    60, 61, 63, 64, 66, 68, 69, 71, 72, 74, 76, 77, 79, 81, 82, 84,
+    86, 87, 89, 91, 93, 95, 96, 98, 100, 102, 104, 106, 108, 110, 112, 114,
+    116, 118, 120, 122, 124, 126, 128, 130, 132, 134, 136, 138, 141, 143, 145, 147,
+    149, 152, 154, 156, 158, 161, 163, 165, 167, 170, 172, 175, 177, 179, 182, 184,
+    187, 189, 191, 194, 196, 199, 201, 204, 206, 209, 211, 214, 216, 219, 222, 224,
+    227, 229, 232, 235, 237, 240, 243, 245, 248, 251, 253, 256, 259, 262, 264, 267,
+    270, 273, 275, 278, 281, 284, 287, 289, 292, 295, 298, 301, 304, 307, 309, 312,
+    315, 318, 321, 324, 327, 330, 333, 336, 339, 342, 345, 348, 351, 354, 357, 360,
+    363, 366, 369, 372, 375, 378, 381, 384, 387, 390, 393, 396, 399, 402, 405, 408,
+    411, 414, 417, 420, 424, 427, 430, 433, 436, 439, 442, 445, 448, 452, 455, 458,
+    461, 464, 467, 470, 473, 477, 480, 483, 486, 489, 492, 495, 498, 502, 505, 508,
+    511, 514, 517, 520, 524, 527, 530, 533, 536, 539, 542, 545, 549, 552, 555, 558,
+    561, 564, 567, 570, 574, 577, 580, 583, 586, 589, 592, 595, 598, 602, 605, 608,
+    611, 614, 617, 620, 623, 626, 629, 632, 635, 638, 641, 644, 647, 650, 653, 656,
+    659, 662, 665, 668, 671, 674, 677, 680, 683, 686, 689, 692, 695, 698, 701, 704,
+    707, 710, 713, 715, 718, 721, 724, 727, 730, 733, 735, 738, 741, 744, 747, 749,
+    752, 755, 758, 760, 763, 766, 769, 771, 774, 777, 779, 782, 785, 787, 790, 793,
+    795, 798, 800, 803, 806, 808, 811, 813, 816, 818, 821, 823, 826, 828, 831, 833,
+    835, 838, 840, 843, 845, 847, 850, 852, 855, 857, 859, 861, 864, 866, 868, 870,
+    873, 875, 877, 879, 881, 884, 886, 888, 890, 892, 894, 896, 898, 900, 902, 904,
+    906, 908, 910, 912, 914, 916, 918, 920, 922, 924, 926, 927, 929, 931, 933, 935,
+    936, 938, 940, 941, 943, 945, 946, 948, 950, 951, 953, 954, 956, 958, 959, 961,
+    962, 964, 965, 966, 968, 969, 971, 972, 973, 975, 976, 977, 979, 980, 981, 982,
+    984, 985, 986, 987, 988, 989, 990, 992, 993, 994, 995, 996, 997, 998, 999, 1000,
+    1000, 1001, 1002, 1003, 1004, 1005, 1006, 1006, 1007, 1008, 1009, 1009, 1010, 1011, 1011, 1012,
+    1013, 1013, 1014, 1014, 1015, 1015, 1016, 1016, 1017, 1017, 1018, 1018, 1019, 1019, 1019, 1020,
+    1020, 1020, 1021, 1021, 1021, 1021, 1022, 1022, 1022, 1022, 1022, 1022, 1022, 1022, 1022, 1022,
+    1023, 1022,
+};
+
+static double sine_tone_print(double pos) {
+    int p = (int)pos;
+    int off = TONE_WIDTH - p;
+    if (off < TONE_WIDTH / 2) {
+        p = off;
+    }
+    return sine_tone[p];
+}
+
+static double sawtooth_tone_print(double pos) {
+    return pos;
+}
+
+static double triangle_tone_print(double pos) {
+    return pos < 512 ? pos * 2 : (1023 - pos) * 2;
+}
+
+static double noise_tone_print(double pos) {
+    // deterministic, semi-random noise
+    return (int32_t)(pos * 7919) & 1023;
+}
+
+static double square_wave_tone_print(double pos) {
+    return pos < 512 ? 1023 : 0;
+}
+
+/******************************************************************************/
+// Musical progressions.
+
+static const double chromatic_interval[] = {
+    1.0, 1.0417, 1.125, 1.2, 1.25, 1.3333, 1.4063, 1.5, 1.6, 1.6667, 1.8, 1.875,
+};
+#define CHROMATIC(i) (chromatic_interval[i])
+static const double major_scale_interval[] = {
+    CHROMATIC(0), CHROMATIC(2), CHROMATIC(4), CHROMATIC(5), CHROMATIC(7), CHROMATIC(9), CHROMATIC(11),
+};
+static const double minor_scale_interval[] = {
+    CHROMATIC(0), CHROMATIC(2), CHROMATIC(3), CHROMATIC(5), CHROMATIC(7), CHROMATIC(8), CHROMATIC(10),
+};
+static const double diminished_interval[] = {
+    CHROMATIC(0), CHROMATIC(3), CHROMATIC(6), CHROMATIC(9),
+};
+static const double whole_tone_interval[] = {
+    CHROMATIC(0), CHROMATIC(2), CHROMATIC(4), CHROMATIC(6), CHROMATIC(8), CHROMATIC(10),
+};
+#undef CHROMATIC
+
+static const sound_synth_progression_t chromatic = { chromatic_interval, 12 };
+static const sound_synth_progression_t major_scale = { major_scale_interval, 7 };
+static const sound_synth_progression_t minor_scale = { minor_scale_interval, 7 };
+static const sound_synth_progression_t diminished = { diminished_interval, 4 };
+static const sound_synth_progression_t whole_tone = { whole_tone_interval, 6 };
+
+static double frequency_from_progression(double root, const sound_synth_progression_t *progression, int offset) {
+    int octave = offset / progression->length;
+    int index = offset % progression->length;
+    return root * pow(2, octave) * progression->interval[index];
+}
+
+/******************************************************************************/
+// Effects. These only use the effects the parser creates.
+
+static void no_interpolation(sound_synth_tone_effect_t *context) {
+}
+
+// parameter[0]: end frequency
+static void linear_interpolation(sound_synth_tone_effect_t *context) {
+    double start = current_effect()->frequency;
+    double interval = (context->parameter[0] - start) / context->steps;
+    frequency = start + interval * context->step;
+}
+
+// parameter[0]: end frequency
+static void logarithmic_interpolation(sound_synth_tone_effect_t *context) {
+    double start = current_effect()->frequency;
+    frequency = start + (log10(MAX(context->step, 0.1)) * (context->parameter[0] - start)) / 1.95;
+}
+
+// parameter[0]: end frequency
+static void curve_interpolation(sound_synth_tone_effect_t *context) {
+    double start = current_effect()->frequency;
+    frequency = sin((context->step * 3.12159) / 180.0) * (context->parameter[0] - start) + start;
+}
+
+// parameter[0]: end frequency
+static void warble_interpolation(sound_synth_tone_effect_t *context) {
+    double start = current_effect()->frequency;
+    frequency = sin(context->step) * (context->parameter[0] - start) + start;
+}
+
+// parameter[0]: end frequency
+static void exponential_rising_interpolation(sound_synth_tone_effect_t *context) {
+    frequency = current_effect()->frequency + sin(0.01745329 * context->step) * context->parameter[0];
+}
+
+static void exponential_falling_interpolation(sound_synth_tone_effect_t *context) {
+    frequency = current_effect()->frequency + cos(0.01745329 * context->step) * context->parameter[0];
+}
+
+static void arpeggio_ascending(sound_synth_tone_effect_t *context) {
+    frequency = frequency_from_progression(current_effect()->frequency, context->parameter_p, context->step);
+}
+
+static void arpeggio_descending(sound_synth_tone_effect_t *context) {
+    frequency = frequency_from_progression(current_effect()->frequency, context->parameter_p, context->steps - context->step - 1);
+}
+
+// parameter[0]: vibrato frequency multiplier
+static void frequency_vibrato_effect(sound_synth_tone_effect_t *context) {
+    if (context->step == 0) {
+        return;
+    }
+    if (context->step % 2 == 0) {
+        frequency /= context->parameter[0];
+    } else {
+        frequency *= context->parameter[0];
+    }
+}
+
+// parameter[0]: vibrato volume multiplier
+static void volume_vibrato_effect(sound_synth_tone_effect_t *context) {
+    if (context->step == 0) {
+        return;
+    }
+    if (context->step % 2 == 0) {
+        volume /= context->parameter[0];
+    } else {
+        volume *= context->parameter[0];
+    }
+}
+
+// parameter[0]: end volume
+static void volume_ramp_effect(sound_synth_tone_effect_t *context) {
+    double start = current_effect()->volume;
+    double delta = (context->parameter[0] - start) / context->steps;
+    volume = start + context->step * delta;
+}
+
+/******************************************************************************/
+// Parsing.
+
+typedef struct _sound_synth_builtin_t {
+    const char *name;
+    const char *expr;
+} sound_synth_builtin_t;
+
+static const sound_synth_builtin_t builtin_sounds[] = {
+    { "giggle", "010230988019008440044008881023001601003300240000000000000000000000000000,110232570087411440044008880352005901003300010000000000000000010000000000,310232729021105440288908880091006300000000240700020000000000003000000000,310232729010205440288908880091006300000000240700020000000000003000000000,310232729011405440288908880091006300000000240700020000000000003000000000" },
+    { "happy", "010231992066911440044008880262002800001800020500000000000000010000000000,002322129029508440240408880000000400022400110000000000000000007500000000,000002129029509440240408880145000400022400110000000000000000007500000000" },
+    { "hello", "310230673019702440118708881023012800000000240000000000000000000000000000,300001064001602440098108880000012800000100040000000000000000000000000000,310231064029302440098108881023012800000100040000000000000000000000000000" },
+    { "mysterious", "400002390033100440240408880477000400022400110400000000000000008000000000,405512845385000440044008880000012803010500160000000000000000085000500015" },
+    { "sad", "310232226070801440162408881023012800000100240000000000000000000000000000,310231623093602440093908880000012800000100240000000000000000000000000000" },
+    { "slide", "105202325022302440240408881023012801020000110400000000000000010000000000,010232520091002440044008881023012801022400110400000000000000010000000000" },
+    { "soaring", "210234009530905440599908881023002202000400020250000000000000020000000000,402233727273014440044008880000003101024400030000000000000000000000000000" },
+    { "spring", "306590037116312440058708880807003400000000240000000000000000050000000000,010230037116313440058708881023003100000000240000000000000000050000000000" },
+    { "twinkle", "010180007672209440075608880855012800000000240000000000000000000000000000" },
+    { "yawn", "200002281133202440150008881023012801024100240400030000000000010000000000,005312520091002440044008880636012801022400110300000000000000010000000000,008220784019008440044008880681001600005500240000000000000000005000000000,004790784019008440044008880298001600000000240000000000000000005000000000,003210784019008440044008880108001600003300080000000000000000005000000000" },
+};
+
+static const char *replace_builtin_sound(const char *expr) {
+    for (size_t i = 0; i < MP_ARRAY_SIZE(builtin_sounds); ++i) {
+        if (strcmp(expr, builtin_sounds[i].name) == 0) {
+            return builtin_sounds[i].expr;
+        }
+    }
+    return expr;
+}
+
+// Returns -1 if the characters aren't all digits.
+static int parse_int(const char *chars, size_t len) {
+    int value = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (chars[i] < '0' || chars[i] > '9') {
+            return -1;
+        }
+        value = value * 10 + chars[i] - '0';
+    }
+    return value;
+}
+
+static int apply_random(int value, int rand) {
+    if (value < 0 || rand < 0) {
+        return -1;
+    }
+    // A random integer in [0, rand * 2 + 1).
+    uint32_t range = rand * 2 + 1;
+    int delta = (int)(((uint64_t)mp_js_rng_generate_random_word() * range) >> 32) - rand;
+    return abs(value + delta);
+}
+
+// https://github.com/lancaster-university/codal-bitsflow-v2/blob/master/source/SoundExpressions.cpp#L115
+static bool parse_sound_expression(const char *chars, sound_synth_effect_t *fx) {
+    int wave = parse_int(chars, 1);
+    int effect_volume = parse_int(chars + 1, 4);
+    int start_frequency = parse_int(chars + 5, 4);
+    int duration = parse_int(chars + 9, 4);
+    int shape = parse_int(chars + 13, 2);
+    // [15] unused. This was start frequency but we use frequency above.
+    int end_frequency = parse_int(chars + 18, 4);
+    // [22] unused. This was start volume but we use volume above.
+    int end_volume = parse_int(chars + 26, 4);
+    int steps = parse_int(chars + 30, 4);
+    int fx_choice = parse_int(chars + 34, 2);
+    int fx_param = parse_int(chars + 36, 4);
+    int fxn_steps = parse_int(chars + 40, 4);
+
+    // Randomness to be applied when the effect is used.
+    start_frequency = apply_random(start_frequency, parse_int(chars + 44, 4));
+    end_frequency = apply_random(end_frequency, parse_int(chars + 48, 4));
+    effect_volume = apply_random(effect_volume, parse_int(chars + 52, 4));
+    end_volume = apply_random(end_volume, parse_int(chars + 56, 4));
+    duration = apply_random(duration, parse_int(chars + 60, 4));
+    fx_param = apply_random(fx_param, parse_int(chars + 64, 4));
+    fxn_steps = apply_random(fxn_steps, parse_int(chars + 68, 4));
+
+    if (wave < 0 || shape < 0 || steps < 0 || fx_choice < 0
+        || start_frequency == -1 || end_frequency == -1 || effect_volume == -1
+        || end_volume == -1 || duration == -1 || fx_param == -1 || fxn_steps == -1) {
+        return false;
+    }
+
+    memset(fx, 0, sizeof(*fx));
+    for (int i = 0; i < TONE_EFFECTS; ++i) {
+        fx->effects[i].effect = no_interpolation;
+    }
+
+    switch (wave) {
+        case 1:
+            fx->tone_print = sawtooth_tone_print;
+            break;
+        case 2:
+            fx->tone_print = triangle_tone_print;
+            break;
+        case 3:
+            fx->tone_print = square_wave_tone_print;
+            break;
+        case 4:
+            fx->tone_print = noise_tone_print;
+            break;
+        default:
+            fx->tone_print = sine_tone_print;
+            break;
+    }
+
+    fx->frequency = start_frequency;
+    fx->duration = duration;
+
+    sound_synth_tone_effect_t *shape_fx = &fx->effects[0];
+    shape_fx->steps = steps;
+    shape_fx->parameter[0] = end_frequency;
+    switch (shape) {
+        case 1:
+            shape_fx->effect = linear_interpolation;
+            break;
+        case 2:
+            shape_fx->effect = curve_interpolation;
+            break;
+        case 5:
+            shape_fx->effect = exponential_rising_interpolation;
+            break;
+        case 6:
+            shape_fx->effect = exponential_falling_interpolation;
+            break;
+        case 8:
+        case 10:
+        case 12:
+        case 14:
+        case 16:
+            shape_fx->effect = arpeggio_ascending;
+            break;
+        case 9:
+        case 11:
+        case 13:
+        case 15:
+        case 17:
+            shape_fx->effect = arpeggio_descending;
+            break;
+        case 18:
+            shape_fx->effect = logarithmic_interpolation;
+            break;
+    }
+    switch (shape) {
+        case 8:
+        case 9:
+            shape_fx->parameter_p = &major_scale;
+            break;
+        case 10:
+        case 11:
+            shape_fx->parameter_p = &minor_scale;
+            break;
+        case 12:
+        case 13:
+            shape_fx->parameter_p = &diminished;
+            break;
+        case 14:
+        case 15:
+            shape_fx->parameter_p = &chromatic;
+            break;
+        case 16:
+        case 17:
+            shape_fx->parameter_p = &whole_tone;
+            break;
+    }
+
+    // Volume envelope.
+    fx->volume = MIN(effect_volume, SAMPLE_RANGE) / 1023.0;
+    fx->effects[1].effect = volume_ramp_effect;
+    fx->effects[1].steps = 36;
+    fx->effects[1].parameter[0] = MIN(end_volume, SAMPLE_RANGE) / 1023.0;
+
+    // Vibrato effect. Steps need to be spread across duration evenly.
+    int normalized_fxn_steps = (int)floor((fx->duration / 10000.0) * fxn_steps + 0.5);
+    sound_synth_tone_effect_t *vibrato_fx = &fx->effects[2];
+    switch (fx_choice) {
+        case 1:
+            vibrato_fx->steps = normalized_fxn_steps;
+            vibrato_fx->effect = frequency_vibrato_effect;
+            vibrato_fx->parameter[0] = fx_param;
+            break;
+        case 2:
+            vibrato_fx->steps = normalized_fxn_steps;
+            vibrato_fx->effect = volume_vibrato_effect;
+            vibrato_fx->parameter[0] = fx_param;
+            break;
+        case 3:
+            vibrato_fx->steps = normalized_fxn_steps;
+            vibrato_fx->effect = warble_interpolation;
+            vibrato_fx->parameter[0] = fx_param;
+            break;
+    }
+    return true;
+}
+
+/******************************************************************************/
+// Synthesis.
+
+static int determine_sample_count(int playout_time) {
+    if (playout_time < 0) {
+        playout_time = -playout_time;
+    }
+    double seconds = playout_time / 1000.0;
+    return (int)floor(SOUND_SYNTH_SAMPLE_RATE * seconds);
+}
+
+static void free_effects(void) {
+    if (MP_STATE_PORT(sound_synth_effects) != NULL) {
+        m_del(sound_synth_effect_t, MP_STATE_PORT(sound_synth_effects), effect_count);
+        MP_STATE_PORT(sound_synth_effects) = NULL;
+    }
+    effect_count = 0;
+}
+
+// Returns true if it finished playing the effects.
+static bool next_sound_effect(void) {
+    bool had_effect = current_effect() != NULL;
+
+    // If a sequence of effects are being played, move on to the next.
+    // If not, select the first in the buffer.
+    if (had_effect) {
+        effect_pointer++;
+    } else {
+        effect_pointer = 0;
+    }
+
+    if ((size_t)effect_pointer >= effect_count) {
+        // If we have an effect with a negative duration, repeat the effects.
+        effect_pointer = 0;
+        if (effect_count == 0 || current_effect()->duration >= 0) {
+            // This is called from JavaScript so the effects are freed by the
+            // next play or stop, which are called from Python.
+            effect_pointer = -1;
+            samples_written = 0;
+            samples_to_write = 0;
+            position = 0;
+            return had_effect;
+        }
+    }
+
+    sound_synth_effect_t *effect = current_effect();
+    samples_to_write = determine_sample_count(effect->duration);
+    frequency = effect->frequency;
+    volume = effect->volume;
+    samples_written = 0;
+
+    for (int i = 0; i < TONE_EFFECTS; i++) {
+        effect->effects[i].step = 0;
+        effect->effects[i].steps = MAX(effect->effects[i].steps, 1);
+        samples_per_step[i] = samples_to_write / effect->effects[i].steps;
+    }
+    return false;
+}
+
+void sound_synth_play(const char *expr) {
+    sound_synth_stop();
+
+    expr = replace_builtin_sound(expr);
+    size_t len = strlen(expr);
+    size_t count = (len + 1) / (CHARS_PER_EFFECT + 1);
+    if (count == 0 || len != count * (CHARS_PER_EFFECT + 1) - 1) {
+        return;
+    }
+    sound_synth_effect_t *effects = m_new(sound_synth_effect_t, count);
+    for (size_t i = 0; i < count; ++i) {
+        const char *chars = expr + i * (CHARS_PER_EFFECT + 1);
+        if ((i > 0 && chars[-1] != ',') || !parse_sound_expression(chars, &effects[i])) {
+            m_del(sound_synth_effect_t, effects, count);
+            return;
+        }
+    }
+    MP_STATE_PORT(sound_synth_effects) = effects;
+    effect_count = count;
+    active = true;
+    next_sound_effect();
+}
+
+void sound_synth_stop(void) {
+    active = false;
+    effect_pointer = -1;
+    samples_written = 0;
+    samples_to_write = 0;
+    position = 0;
+    free_effects();
+}
+
+bool sound_synth_is_active(void) {
+    return active;
+}
+
+float *sound_synth_buffer(void) {
+    return buffer;
+}
+
+static inline void write_sample(int sample, double value) {
+    // From the synthesizer's 0 to 1023 to -1 to 1.
+    buffer[sample] = (value - 512) / 512;
+}
+
+size_t sound_synth_pull(void) {
+    if (!active) {
+        return 0;
+    }
+
+    int sample = 0;
+    bool done = false;
+    while (!done) {
+        if (samples_written == samples_to_write) {
+            bool render_complete = next_sound_effect();
+            // If we have just completed playing the last effect, we're done.
+            if (samples_to_write == 0) {
+                done = true;
+                if (render_complete) {
+                    active = false;
+                }
+            }
+        }
+
+        // Generate some samples with the current effect parameters.
+        while (samples_written < samples_to_write) {
+            sound_synth_effect_t *effect = current_effect();
+            double skip = (TONE_WIDTH * frequency) / SOUND_SYNTH_SAMPLE_RATE;
+            double gain = (SAMPLE_RANGE * volume) / 1024;
+            double offset = 512 - 512 * gain;
+
+            int effect_step_end[TONE_EFFECTS];
+            for (int i = 0; i < TONE_EFFECTS; i++) {
+                effect_step_end[i] = samples_per_step[i] * effect->effects[i].step;
+                if (effect->effects[i].step == effect->effects[i].steps - 1) {
+                    effect_step_end[i] = samples_to_write;
+                }
+            }
+            int step_end_position = effect_step_end[0];
+            for (int i = 1; i < TONE_EFFECTS; i++) {
+                step_end_position = MIN(step_end_position, effect_step_end[i]);
+            }
+
+            // Write samples until the end of the next effect step.
+            while (samples_written < step_end_position) {
+                // Stop when we've filled the buffer.
+                if (sample == SOUND_SYNTH_BUFFER_SIZE) {
+                    return SOUND_SYNTH_BUFFER_SIZE;
+                }
+                double s = effect->tone_print(MAX(position, 0));
+                write_sample(sample, s * gain + offset);
+                sample++;
+                samples_written++;
+                position += skip;
+                // Keep the tone print pointer in range.
+                while (position > TONE_WIDTH) {
+                    position -= TONE_WIDTH;
+                }
+            }
+
+            // Invoke the effect function for any effects that are due.
+            for (int i = 0; i < TONE_EFFECTS; i++) {
+                sound_synth_tone_effect_t *tone_effect = &effect->effects[i];
+                if (samples_written == effect_step_end[i] && tone_effect->step < tone_effect->steps) {
+                    tone_effect->effect(tone_effect);
+                    tone_effect->step++;
+                }
+            }
+        }
+    }
+
+    // Pad the buffer with silence.
+    while (sample < SOUND_SYNTH_BUFFER_SIZE) {
+        write_sample(sample++, SAMPLE_RANGE * 0.5);
+    }
+    return SOUND_SYNTH_BUFFER_SIZE;
+}
@@ -0,0 +1,22 @@
+#ifndef MICROPY_INCLUDED_SIM_SOUND_SYNTH_H
+#define MICROPY_INCLUDED_SIM_SOUND_SYNTH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SOUND_SYNTH_SAMPLE_RATE (44100)
+#define SOUND_SYNTH_BUFFER_SIZE (512)
+
+// Starts playing a sound expression or the name of a built-in sound.
+void sound_synth_play(const char *expr);
+void sound_synth_stop(void);
+bool sound_synth_is_active(void);
+
+// The buffer that sound_synth_pull synthesizes into, as -1 to 1 float PCM.
+float *sound_synth_buffer(void);
+
+// Synthesizes the next buffer of audio. Called from JavaScript when the audio
+// output needs more. Returns the number of samples, 0 when it has finished.
+size_t sound_synth_pull(void);
+
+#endif // MICROPY_INCLUDED_SIM_SOUND_SYNTH_H
@@ -0,0 +1,117 @@
+import { AudioOutput } from "./board/audio/headless";
+import { AudioRing } from "./board/audio/ring";
+import { FileSystem } from "./board/fs";
+import { Firmware } from "./board/headless";
+import { SharedBoardState } from "./board/shared-state";
+import { EmscriptenModule } from "./board/wasm";
+import { compileWasm } from "./board/wasm-cache";
+import { WorkerBoard } from "./board/worker-board";
+
+// Runs the firmware in a worker. See board/worker-host.ts for the main
+// thread side and the messages.
+
+// The worker globals we use, as tsconfig only includes the DOM types.
+declare const self: {
+  // Provided by firmware.js
+  createModule: (args: object) => Promise<EmscriptenModule>;
+  postMessage(message: any, transfer?: Transferable[]): void;
+  addEventListener(type: "message", listener: (e: MessageEvent) => void): void;
+};
+declare function importScripts(...urls: string[]): void;
+
+// Relative to the worker. The dist build rewrites these to the
+// content-hashed names.
+const loadFirmware = async (blocking: boolean): Promise<Firmware> => {
+  importScripts(blocking ? "firmware-blocking.js" : "firmware.js");
+  const wasm = await compileWasm(
+    blocking ? "firmware-blocking.wasm" : "firmware.wasm"
+  );
+  return { createModule: self.createModule, wasm, blocking };
+};
+
+const postMessage = (kind: string, data: any, transfer?: Transferable[]) =>
+  self.postMessage({ kind, ...data }, transfer);
+
+// Samples go straight to the page's rings. The rest is for its nodes.
+const createAudioOutput = (buffers: SharedArrayBuffer[]): AudioOutput => ({
+  rings: buffers.map((buffer) => new AudioRing(buffer)),
+  setVolume: (value) => postMessage("audio", { setting: "volume", value }),
+  setPeriodUs: (value) => postMessage("audio", { setting: "periodUs", value }),
+  setAmplitudeU10: (value) =>
+    postMessage("audio", { setting: "amplitudeU10", value }),
+});
+
+const fs = new FileSystem();
+let boardPromise: Promise<WorkerBoard> | undefined;
+
+const createBoard = async (shared: SharedBoardState, blocking: boolean) =>
+  new WorkerBoard(
+    await loadFirmware(blocking),
+    fs,
+    {
+      onStateChange: (change) => postMessage("state_change", { change }),
+      onSerialOutput: (data) => postMessage("serial_output", { data }),
+      // Sent as written so the main thread only decodes it if the embedder
+      // wants text.
+      onSerialOutputBytes: (data) => {
+        const copy = data.slice();
+        postMessage("serial_output", { data: copy }, [copy.buffer]);
+      },
+      // A view of the firmware's memory, so copy just the packet.
+      onRadioOutput: (data) =>
+        postMessage("radio_output", { data: data.slice() }),
+      onLogOutput: (data) => postMessage("log_output", { data }),
+      onLogDelete: () => postMessage("log_delete", {}),
+    },
+    shared
+  );
+
+self.addEventListener("message", async (e: MessageEvent) => {
+  const { data } = e;
+  switch (data.kind) {
+    case "init": {
+      boardPromise = createBoard(
+        new SharedBoardState(data.buffer),
+        data.blocking
+      );
+      break;
+    }
+    case "flash": {
+      const board = await boardPromise!;
+      const filesystem: Record<string, Uint8Array> = data.filesystem;
+      fs.clear();
+      Object.entries(filesystem).forEach(([name, value]) => {
+        const idx = fs.create(name);
+        fs.write(idx, value, true);
+      });
+      board.dataLogging.delete();
+      break;
+    }
+    case "start": {
+      const board = await boardPromise!;
+      board.heapSize = data.heapSize;
+      // Without a worklet on the page audio is only timed.
+      board.audio.output =
+        data.audioBuffers && createAudioOutput(data.audioBuffers);
+      const { kind, panicCode, error } = await board.start(data.runId);
+      postMessage("stopped", {
+        runId: data.runId,
+        stopKind: kind,
+        panicCode,
+        error: error?.toString(),
+      });
+      break;
+    }
+    case "stats": {
+      const board = await boardPromise!;
+      if (data.enabled !== undefined) {
+        board.enableStats(data.enabled);
+      }
+      postMessage("stats", {
+        stats: board.takeStats() ?? null,
+        gc: board.gcStats() ?? null,
+      });
+      break;
+    }
+  }
+});